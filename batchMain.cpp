@@ -0,0 +1,145 @@
+// External Libraries
+#include "batch.h"
+#include "lockstep.h"
+#include "threadpool.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+#define LOCKSTEP_KEY_FRAMES 8 // Frames each generated key press (or release) is held for
+
+// Per-lane generated input: every LOCKSTEP_KEY_FRAMES frames a lane holds one
+// random key or none, drawn from a hash of (lane, period) so both runs agree
+static Word LaneKeys(std::size_t lane, unsigned long frame) {
+  std::uint64_t hash = (lane + 1) * 0x9E3779B97F4A7C15ULL ^ (frame / LOCKSTEP_KEY_FRAMES) * 0xBF58476D1CE4E5B9ULL;
+  hash ^= hash >> 31;
+  hash *= 0x94D049BB133111EBULL;
+  hash ^= hash >> 29;
+  return hash & 1 ? 1 << ((hash >> 1) & 0xF) : 0;
+}
+
+// Runs <lanes> copies of a ROM in lockstep, then the same work as independent
+// Chip8s on a thread pool, and reports both throughputs. Each lane gets its own
+// seed and key presses so lanes diverge the way independent players would
+static int CompareLockstep(const char *romPath, std::size_t lanes, unsigned long frames, unsigned threads) {
+  const unsigned long instructionsPerFrame = 16;
+
+  // Lockstep
+  Chip8Lockstep lockstep(lanes, instructionsPerFrame);
+  for (std::size_t i = 0; i < lanes; i++) {
+    lockstep.Seed(i, DEFAULT_SEED + i);
+  }
+  if (!lockstep.LoadROM(romPath)) {
+    std::cerr << "Could not load " << romPath << "\n";
+    return EXIT_FAILURE;
+  }
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned long frame = 0; frame < frames; frame++) {
+    for (std::size_t i = 0; i < lanes; i++) {
+      lockstep.SetKeys(i, LaneKeys(i, frame));
+    }
+    lockstep.RunFrames(1);
+  }
+  double lockstepSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  // Scalar
+  std::vector<std::unique_ptr<Chip8>> scalar;
+  std::vector<ScriptedInput> inputs(lanes);
+  for (std::size_t i = 0; i < lanes; i++) {
+    scalar.push_back(std::make_unique<Chip8>(instructionsPerFrame * FRAME_RATE, DEBUG_FALSE));
+    scalar[i]->AttachInput(&inputs[i]);
+    scalar[i]->Seed(DEFAULT_SEED + i);
+    scalar[i]->LoadROM(romPath);
+  }
+  start = std::chrono::steady_clock::now();
+  {
+    ThreadPool pool(threads);
+    for (std::size_t i = 0; i < lanes; i++) {
+      pool.Submit([&, i](unsigned) {
+        for (unsigned long frame = 0; frame < frames; frame++) {
+          inputs[i].SetKeys(LaneKeys(i, frame));
+          scalar[i]->RunFrames(1);
+        }
+      });
+    }
+    pool.Wait();
+  }
+  double scalarSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::size_t mismatches = 0;
+  for (std::size_t i = 0; i < lanes; i++) {
+    if (std::memcmp(lockstep.GetDisplay(i), scalar[i]->GetDisplay(), DISPLAY_HEIGHT * sizeof(std::uint64_t)) != 0)
+      mismatches++;
+  }
+
+  double instructions = double(lanes) * frames * instructionsPerFrame;
+  double vectorShare = double(lockstep.VectorLaneOps()) / (lockstep.VectorLaneOps() + lockstep.ScalarLaneOps());
+  std::cout << "lanes,frames,lockstep_ips,scalar_ips,scalar_threads,vector_share,groups_per_step,mismatches\n"
+            << lanes << "," << frames << ","
+            << instructions / lockstepSeconds << "," << instructions / scalarSeconds << "," << threads << ","
+            << vectorShare << "," << double(lockstep.Groups()) / (double(frames) * instructionsPerFrame) << ","
+            << mismatches << "\n";
+  return mismatches == 0 ? 0 : EXIT_FAILURE;
+}
+
+// Replays a recording at full speed and checks the final state against the recorded one
+static int PlayReplay(const char *romPath, const char *replayPath) {
+  Replay replay;
+  Chip8 chip8(DEFAULT_IPS, DEBUG_FALSE);
+  if (!replay.Load(replayPath)) {
+    std::cerr << "Could not load replay " << replayPath << "\n";
+    return EXIT_FAILURE;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  if (!chip8.PlayReplay(romPath, replay)) {
+    std::cerr << romPath << " is missing or is not the ROM the replay was recorded with\n";
+    return EXIT_FAILURE;
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  bool match = chip8.HashState() == replay.stateHash;
+  std::cout << "cycles,ips,state_hash,match\n"
+            << chip8.GetCycle() << "," << chip8.GetCycle() / seconds << ","
+            << std::hex << std::setfill('0') << std::setw(16) << chip8.HashState() << std::dec << ","
+            << (match ? "yes" : "no") << "\n";
+  return match ? 0 : EXIT_FAILURE;
+}
+
+int main(int argc, char **argv) {
+  unsigned hardwareThreads = std::thread::hardware_concurrency();
+
+  if (argc >= 5 && std::strcmp(argv[1], "--lockstep") == 0) {
+    unsigned threads = argc > 5 ? std::atoi(argv[5]) : hardwareThreads;
+    return CompareLockstep(argv[2], std::atoi(argv[3]), std::atol(argv[4]), threads);
+  }
+  if (argc >= 4 && std::strcmp(argv[1], "--replay") == 0) {
+    return PlayReplay(argv[2], argv[3]);
+  }
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <manifest> [threads]\n"
+              << "       " << argv[0] << " --lockstep <rom> <lanes> <frames> [threads]\n"
+              << "       " << argv[0] << " --replay <rom> <replay>\n";
+    return EXIT_FAILURE;
+  }
+  unsigned threads = argc > 2 ? std::atoi(argv[2]) : hardwareThreads;
+
+  // Batch
+  Batch batch;
+  if (!batch.LoadManifest(argv[1])) {
+    std::cerr << "Could not load manifest " << argv[1] << "\n";
+    return EXIT_FAILURE;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  batch.Run(threads);
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  batch.WriteResults(std::cout);
+  std::cerr << batch.Size() << " jobs on " << threads << " threads in " << seconds << "s\n";
+
+  return 0;
+}
@@ -0,0 +1,119 @@
+// External Libraries
+#include "chip8.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+#define BENCH_REPEATS 3                // Best of, to filter out scheduler noise
+#define MICRO_CYCLES 20000000UL        // Instructions per microbenchmark run
+#define MACRO_FRAMES 20000UL           // Default frames per ROM
+
+#if defined(CHIP8_DISPATCH_THREADED)
+#define BENCH_DISPATCH "threaded"
+#elif defined(CHIP8_DISPATCH_SWITCH)
+#define BENCH_DISPATCH "switch"
+#else
+#define BENCH_DISPATCH "table"
+#endif
+
+// Endless loop exercising one opcode family; every program ends with 1200 (jump to start)
+struct MicroBenchmark {
+  const char *name;
+  std::vector<Word> program;
+};
+
+static const MicroBenchmark microBenchmarks[] = {
+  // Cheapest handlers back to back, so the time is mostly fetch and dispatch
+  { "dispatch", { 0x7001, 0x7102, 0x7203, 0x7304, 0x7405, 0x7506, 0x7607, 0x7708, 0x1200 } },
+  { "alu_8xyn", { 0x6A37, 0x6B5C, 0x8AB4, 0x8AB5, 0x8AB6, 0x8AB7, 0x8ABE, 0x8AB1, 0x8AB2, 0x8AB3, 0x8AB0, 0x1200 } },
+  { "skip_3x_4x_5x_9x", { 0x6005, 0x3005, 0x6001, 0x4006, 0x6002, 0x5010, 0x6003, 0x9010, 0x6004, 0x1200 } },
+  { "draw_dxyn", { 0x6008, 0x6117, 0xA000, 0xD015, 0xA005, 0xD01F, 0x7009, 0x00E0, 0x1200 } },
+  { "memory_fx33_fx55_fx65", { 0x60FF, 0xA300, 0xF033, 0xF555, 0xF565, 0xF01E, 0x1200 } },
+  { "call_return", { 0x2204, 0x1200, 0x00EE } },
+};
+
+// Fastest of BENCH_REPEATS runs of work, in seconds
+template <typename Work>
+static double BestOf(Work work) {
+  double best = 1e30;
+  for (int i = 0; i < BENCH_REPEATS; i++) {
+    auto start = std::chrono::steady_clock::now();
+    work();
+    best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+  }
+  return best;
+}
+
+static void RunMicro(const MicroBenchmark &benchmark, bool last) {
+  std::vector<Byte> rom;
+  Chip8 chip8(DEFAULT_IPS, DEBUG_FALSE);
+  for (Word opcode : benchmark.program) {
+    rom.push_back(opcode >> 8);
+    rom.push_back(opcode & 0xFF);
+  }
+
+  double seconds = BestOf([&] {
+    chip8.LoadROM(rom.data(), rom.size());
+    chip8.RunCycles(MICRO_CYCLES);
+  });
+  std::printf("    {\"name\": \"%s\", \"instructions\": %lu, \"seconds\": %.6f, "
+              "\"instructions_per_second\": %.0f, \"ns_per_instruction\": %.3f}%s\n",
+              benchmark.name, MICRO_CYCLES, seconds, MICRO_CYCLES / seconds, seconds * 1e9 / MICRO_CYCLES,
+              last ? "" : ",");
+}
+
+static void RunMacro(const fs::path &romPath, unsigned long frames, bool last) {
+  Chip8 chip8(DEFAULT_IPS, DEBUG_FALSE);
+  unsigned long long instructions = 0;
+
+  double seconds = BestOf([&] {
+    chip8.LoadROM(romPath.c_str());
+    chip8.RunFrames(frames);
+    instructions = chip8.GetCycle();
+  });
+  // Idle loops and Fx0A waits are fast-forwarded, so ns_per_frame is not comparable with runs that executed them
+  std::printf("    {\"rom\": \"%s\", \"idle_skipping\": true, \"frames\": %lu, \"instructions\": %llu, \"seconds\": %.6f, "
+              "\"instructions_per_second\": %.0f, \"ns_per_frame\": %.1f}%s\n",
+              romPath.filename().c_str(), frames, instructions, seconds, instructions / seconds,
+              seconds * 1e9 / frames, last ? "" : ",");
+}
+
+int main(int argc, char **argv) {
+  fs::path romDirectory = argc > 1 ? argv[1] : "../roms";
+  unsigned long frames = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : MACRO_FRAMES;
+  std::vector<fs::path> roms;
+
+  std::error_code error;
+  for (const auto &entry : fs::directory_iterator(romDirectory, error)) {
+    if (entry.path().extension() == ".ch8")
+      roms.push_back(entry.path());
+  }
+  std::sort(roms.begin(), roms.end());
+  if (roms.empty())
+    std::fprintf(stderr, "No .ch8 ROMs in %s, skipping macrobenchmarks\n", romDirectory.c_str());
+
+  std::printf("{\n");
+#ifdef CHIP8_JIT
+  std::printf("  \"dispatch\": \"%s\", \"jit\": true, \"emulated_instructions_per_second\": %d,\n", BENCH_DISPATCH, DEFAULT_IPS);
+#else
+  std::printf("  \"dispatch\": \"%s\", \"jit\": false, \"emulated_instructions_per_second\": %d,\n", BENCH_DISPATCH, DEFAULT_IPS);
+#endif
+  std::printf("  \"micro\": [\n");
+  std::size_t microCount = sizeof(microBenchmarks) / sizeof(microBenchmarks[0]);
+  for (std::size_t i = 0; i < microCount; i++) {
+    RunMicro(microBenchmarks[i], i + 1 == microCount);
+  }
+  std::printf("  ],\n  \"macro\": [\n");
+  for (std::size_t i = 0; i < roms.size(); i++) {
+    RunMacro(roms[i], frames, i + 1 == roms.size());
+  }
+  std::printf("  ]\n}\n");
+
+  return 0;
+}
@@ -0,0 +1,14 @@
+#ifndef ALLOCATIONS_H
+#define ALLOCATIONS_H
+
+#include <cstddef>
+
+// Heap allocations made by the calling thread so far through the allocator handed to ImGui,
+// and through operator new as well when built with CHIP8_COUNT_ALLOCATIONS
+unsigned long long ThreadAllocations();
+
+// ImGui allocator hooks (ImGui::SetAllocatorFunctions) that count into ThreadAllocations
+void *CountedAlloc(std::size_t size, void *userData);
+void CountedFree(void *pointer, void *userData);
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "chip8.h"
+
+// Input script line: "<frame> <key mask>", mask bit n = key n held from that frame on
+struct InputEvent {
+  unsigned long frame;
+  Word keys;
+};
+
+// Manifest line: "<rom> <input script | -> <count>f|<count>c [instructions per frame]"
+struct BatchJob {
+  std::string romPath;
+  std::string scriptPath;
+  unsigned long budget;
+  bool budgetInFrames;
+  unsigned long instructionsPerFrame;
+  const char *error; // Set when the line parsed but a field is invalid; reported as the job's result
+};
+
+struct BatchResult {
+  bool loaded;
+  const char *error;
+  unsigned long frames;
+  unsigned long cycles;
+  unsigned long long displayHash;
+  double wallSeconds;
+};
+
+class Batch {
+  private:
+    std::vector<BatchJob> jobs;
+    std::vector<BatchResult> results;
+
+    static bool LoadScript(const std::string &scriptPath, std::vector<InputEvent> &events);
+    static BatchResult RunJob(const BatchJob &job);
+
+  public:
+    int LoadManifest(const char *manifestPath);
+    std::size_t Size() const { return jobs.size(); };
+    void Run(unsigned threads);
+    void WriteResults(std::ostream &out);
+};
+
+#endif
@@ -3,12 +3,13 @@
 
 #include <AL/al.h>
 #include <AL/alc.h>
+#include "peripherals.h"
 
 #define SAMPLE_RATE 44100
 #define FREQUENCY 220
 #define NUM_SAMPLES SAMPLE_RATE
 
-class Buzzer {
+class Buzzer : public AudioDevice {
   private:
     ALuint source;
     ALCdevice *device;
@@ -17,8 +18,8 @@ class Buzzer {
   public:
     Buzzer();
     ~Buzzer();
-    void Play();
-    void Stop();
+    void Play() override;
+    void Stop() override;
 };
 
 #endif
@@ -2,14 +2,42 @@
 #define CHIP_8_H
 
 #include <iostream>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <memory>
-#include <array>
-#include "screen.h"
-#include "buzzer.h"
+#include <mutex>
+#include <string>
+#include <utility>
+#include "clock.h"
+#include "mailbox.h"
+#include "operations.h"
+#include "peripherals.h"
+#include "profile.h"
+#include "random.h"
+#include "replay.h"
+#include "rewind.h"
+#include "spscqueue.h"
+#include "trace.h"
+#ifdef CHIP8_JIT
+#include "jit.h"
+#endif
 
 #define MEMORY 4096
-#define DISPLAY_FREQUENCY (float)1 / 120
+#define DISPLAY_WIDTH 64
+#define DISPLAY_HEIGHT 32
+#define FRAME_RATE 60                 // Frames (and timer decrements) per second
+#define NANOSECONDS 1000000000ULL      // Per second
+#define PAUSED_WAIT (NANOSECONDS / 4)  // Longest idle wait for input while paused or blocked in Fx0A
+#define SPEED_WINDOW (NANOSECONDS / 2)  // Wall time the speed multiplier is averaged over
+#define MAX_CATCHUP_FRAMES 15          // Frames (250 ms) run per main loop iteration before a stall is dropped
+#define DEFAULT_IPS 1920
+#define MAX_IPS 100000000
 #define LOG_WIDTH 50
+#define DEFAULT_SEED 0x43484950382D3845ULL
+#define COMMAND_QUEUE_SIZE 64
 
 #define Byte unsigned char
 #define SignedByte char
@@ -17,85 +45,264 @@
 
 typedef enum { DEBUG_FALSE, DEBUG_TRUE } DebugStates;
 
+// Threaded dispatch needs the GCC/Clang labels-as-values extension; other compilers use a switch
+#if defined(CHIP8_DISPATCH_THREADED) && !defined(__GNUC__)
+#undef CHIP8_DISPATCH_THREADED
+#define CHIP8_DISPATCH_SWITCH
+#endif
+
+// Core state published to the window thread once per emulation loop iteration; the debugger
+// only ever reads this copy, so it never touches the core while the core is running
+struct Snapshot {
+  std::uint64_t rows[DISPLAY_HEIGHT];
+  Byte memory[MEMORY];
+  Byte V[16];
+  Word stack[16];
+  Word I;
+  Word pc;
+  Word opcode;
+  Byte sp;
+  Byte delayTimer;
+  Byte soundTimer;
+  int pressedKey;
+  unsigned long instructionsPerSecond;
+  bool paused;
+  bool waitingForKey;
+  bool turbo;
+  unsigned long turboDrawInterval;
+  float speed;
+  std::size_t rewindFrames;
+  std::size_t rewindBytes;
+#ifdef CHIP8_TRACE
+  TraceBuffer trace;
+#endif
+#ifdef CHIP8_PROFILE
+  Profile profile;
+#endif
+};
+
+// Changes the window thread asks of the emulation thread, applied between frames
+typedef enum {
+  COMMAND_TOGGLE_PAUSE,
+  COMMAND_STEP,              // value = instructions (only while paused)
+  COMMAND_SET_IPS,           // value = instructions per second
+  COMMAND_SET_TURBO,         // value = on/off
+  COMMAND_SET_DRAW_INTERVAL, // value = turbo frames between published frames
+  COMMAND_SET_REWINDING,     // value = rewind button held
+  COMMAND_REWIND_FRAME,      // Steps back one snapshot (only while paused)
+  COMMAND_POKE,              // memory[address] = value
+  COMMAND_LOAD_ROM,          // path
+} CommandTypes;
+
+struct Command {
+  CommandTypes type;
+  unsigned long value;
+  Word address;
+  std::string path;
+
+  Command(CommandTypes type = COMMAND_TOGGLE_PAUSE, unsigned long value = 0, Word address = 0, std::string path = "")
+      : type(type), value(value), address(address), path(std::move(path)) {};
+};
+
 class Chip8 {
   private:
     // Memory & Registers
     Byte memory[MEMORY];
     Byte V[16];
-    Byte key[16];
+    Word keys; // Keypad, bit n set while key n is held (latched once per RunCycles call)
     Word I;
     Word opcode;
-    void (Chip8::*opcodeTable[16])() = {
-      &Chip8::op0xxx,
-      &Chip8::op1xxx,
-      &Chip8::op2xxx,
-      &Chip8::op3xxx,
-      &Chip8::op4xxx,
-      &Chip8::op5xxx,
-      &Chip8::op6xxx,
-      &Chip8::op7xxx,
-      &Chip8::op8xxx,
-      &Chip8::op9xxx,
-      &Chip8::opAxxx,
-      &Chip8::opBxxx,
-      &Chip8::opCxxx,
-      &Chip8::opDxxx,
-      &Chip8::opExxx,
-      &Chip8::opFxxx,
+
+    // Predecoded Instructions (execute == nullptr until an address is first run)
+    struct Instruction {
+      void (Chip8::*execute)(const Instruction &);
+      Word opcode;
+      Word nnn;
+      Byte x, y, n, nn;
+      Byte operation;
     };
+    Instruction decoded[MEMORY];
+    static void (Chip8::*const operationTable[OP_COUNT])(const Instruction &);
 
-    // Display
-    Byte display[DISPLAY_WIDTH * DISPLAY_HEIGHT];
-    std::unique_ptr<Screen> screen;
+    // Display (one 64-bit word per row, pixel x is bit 63 - x)
+    std::uint64_t display[DISPLAY_HEIGHT];
+    std::uint32_t dirtyRows;         // Bit y is set when row y changed since the last TakeDirtyRows
+    unsigned long displayGeneration; // Incremented whenever any pixel changes
 
-    // Sound
-    std::unique_ptr<Buzzer> buzzer;
+    // Peripherals
+    VideoDevice *video;
+    AudioDevice *audio;
+    InputDevice *input;
 
     // State
     Word pc;
     Word stack[16];
     Byte sp;
     Byte debugFlag;
-    Byte instructionFrequency;
-    SignedByte keyPressed;
+    unsigned long instructionsPerSecond;
+    Byte framePhase; // Frame within the current second, spreads instructionsPerSecond evenly
+    unsigned long long cycle; // Instructions executed since Reset
+    unsigned long cyclesLeft; // Instructions left in the current RunCycles call after the executing one
+    bool waitingForKey;       // The last RunCycles call ended blocked in Fx0A
+    unsigned long idleCycles; // Instructions the current RunCycles call fast-forwarded
     bool paused;
 
+    // Random Number Generator (re-seeded from seed on every Reset)
+    Random random;
+    std::uint64_t seed;
+
     // Timers
     Byte delayTimer;
     Byte soundTimer;
-    float lastTime, currentTime, elapsedTime, deltaTime;
+    std::uint64_t lastTime, currentTime, deltaTime; // Nanoseconds
+    std::uint64_t elapsedTime;                      // Nanoseconds x FRAME_RATE, so a frame is exactly NANOSECONDS
+    WallClock wallClock;
+    Clock *clock;
+
+    // Instruction Trace
+#ifdef CHIP8_TRACE
+    TraceBuffer trace;
+#endif
+
+    // Emulation Thread (StartMainLoop runs the core here and the windows on the calling thread; the two
+    // share nothing but the snapshot mailbox, the command and input queues and the wake handshake)
+    struct Frontend {
+      Mailbox<Snapshot> snapshots;
+      SpscQueue<Command, COMMAND_QUEUE_SIZE> commands;
+    };
+    std::unique_ptr<Frontend> frontend; // Only allocated by StartMainLoop, so headless instances stay small
+    std::mutex wakeMutex;               // Guards woken only; the core state is never locked
+    std::condition_variable wake;       // Wakes an idle emulation thread when a command or key change arrives
+    bool woken;
+    std::atomic<bool> running;
+    InputQueue inputQueue;
+    unsigned long stepCounter;          // Instructions stepped while paused, so timers still tick at 60 Hz
+
+    // Fast-Forward
+    bool turbo;
+    unsigned long turboDrawInterval; // Minimum emulated frames between published frames
+    unsigned long speedFrames;       // Frames run since speedTime
+    std::uint64_t speedTime;
+    float speed;                     // Emulated time / wall time
+
+    // Rewind
+    Rewind rewind;
+    bool rewinding;
+
+    // Input Recording
+    std::uint64_t romHash;
+    Replay *recording;
+
+    // Opcode Statistics
+#ifdef CHIP8_PROFILE
+    Profile profile;
+#endif
+
+    // Native Code Translation
+#ifdef CHIP8_JIT
+    std::unique_ptr<Jit> jit;
+#endif
 
     // Functions
     void Reset();
-    void Tick();
+    void RunFrame();
+    void RunLiveFrame(std::uint64_t frameEnd);
+    void EmulationLoop();
+    void ApplyCommands();
+    void Step(unsigned long instructions);
+    void PublishSnapshot();
+    void WaitForWindow(std::uint64_t timeout);
+    void Notify();
+    void RunTurbo();
+    bool BlockedOnKey() const;
+    void UpdateSpeed();
+    unsigned long FrameCycles();
     void EmulateCycle();
     void ProcessInput();
+    // Highest held key, or -1 when none is held (what Fx0A stores)
+    int PressedKey() const { return keys ? std::bit_width(keys) - 1 : -1; };
     void UpdateTimers();
-    void op0xxx();
-    void op1xxx();
-    void op2xxx();
-    void op3xxx();
-    void op4xxx();
-    void op5xxx();
-    void op6xxx();
-    void op7xxx();
-    void op8xxx();
-    void op9xxx();
-    void opAxxx();
-    void opBxxx();
-    void opCxxx();
-    void opDxxx();
-    void opExxx();
-    void opFxxx();
+    void DecrementTimers();
+    void RunThreaded(unsigned long cycles);
+    void SkipIdleLoop(Word jump);
+    void FastForward(int operation, Word address, unsigned long times);
+    void Decode(Word address);
+    void InvalidateDecoded(Word address, Word length);
+    void MarkDirty(std::uint32_t rows);
+    void RecordFrame();
+    bool RewindFrame();
+    void op00E0(const Instruction &instruction);
+    void op00EE(const Instruction &instruction);
+    void op1nnn(const Instruction &instruction);
+    void op2nnn(const Instruction &instruction);
+    void op3xnn(const Instruction &instruction);
+    void op4xnn(const Instruction &instruction);
+    void op5xy0(const Instruction &instruction);
+    void op6xnn(const Instruction &instruction);
+    void op7xnn(const Instruction &instruction);
+    void op8xy0(const Instruction &instruction);
+    void op8xy1(const Instruction &instruction);
+    void op8xy2(const Instruction &instruction);
+    void op8xy3(const Instruction &instruction);
+    void op8xy4(const Instruction &instruction);
+    void op8xy5(const Instruction &instruction);
+    void op8xy6(const Instruction &instruction);
+    void op8xy7(const Instruction &instruction);
+    void op8xyE(const Instruction &instruction);
+    void op9xy0(const Instruction &instruction);
+    void opAnnn(const Instruction &instruction);
+    void opBnnn(const Instruction &instruction);
+    void opCxnn(const Instruction &instruction);
+    void opDxyn(const Instruction &instruction);
+    void opEx9E(const Instruction &instruction);
+    void opExA1(const Instruction &instruction);
+    void opFx07(const Instruction &instruction);
+    void opFx0A(const Instruction &instruction);
+    void opFx15(const Instruction &instruction);
+    void opFx18(const Instruction &instruction);
+    void opFx1E(const Instruction &instruction);
+    void opFx29(const Instruction &instruction);
+    void opFx33(const Instruction &instruction);
+    void opFx55(const Instruction &instruction);
+    void opFx65(const Instruction &instruction);
+    void opUnknown(const Instruction &instruction);
 
     // Friends
-    friend Screen;
+    friend class Jit;
+    friend class Chip8Lockstep;
 
   public:
-    Chip8(Byte instructionFrequency, Byte debugFlag);
+    Chip8(unsigned long instructionsPerSecond, Byte debugFlag);
     ~Chip8();
     int LoadROM(const char *romPath);
+    int LoadROM(const Byte *rom, std::size_t size);
+    void Seed(std::uint64_t seed);
+    void AttachVideo(VideoDevice *video);
+    void AttachAudio(AudioDevice *audio);
+    void AttachInput(InputDevice *input);
+    void AttachClock(Clock *clock);
+    void SetInstructionsPerSecond(unsigned long instructionsPerSecond);
+    unsigned long GetInstructionsPerSecond() const { return instructionsPerSecond; };
+    void RunCycles(unsigned long cycles);
+    void RunFrames(unsigned long frames);
+    std::size_t SaveState(Byte *state, std::size_t size) const;
+    bool LoadState(const Byte *state, std::size_t size);
+    std::uint64_t HashState() const;
+    unsigned long long GetCycle() const { return cycle; };
+    void StartRecording(Replay *replay);
+    void StopRecording();
+    bool PlayReplay(const char *romPath, const Replay &replay);
+    const std::uint64_t *GetDisplay() const { return display; };
+    bool GetPixel(int x, int y) const { return (display[y] >> (DISPLAY_WIDTH - 1 - x)) & 1; };
+    unsigned long GetDisplayGeneration() const { return displayGeneration; };
+    std::uint32_t TakeDirtyRows();
+    // Window thread side of StartMainLoop: swaps in the newest snapshot (false when none arrived since the
+    // last call), and queues a command for the emulation thread (false when the queue is full)
+    bool TakeSnapshot() { return frontend->snapshots.Take(); };
+    const Snapshot &GetSnapshot() const { return frontend->snapshots.Front(); };
+    bool Send(const Command &command);
     void StartMainLoop();
+    void DumpProfile(std::FILE *out) const;
 };
 
 #endif
@@ -0,0 +1,76 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#define SLEEP_SPIN_MARGIN 250000 // Default nanoseconds before a deadline spent spinning instead of sleeping
+
+// Time source for the main loop's display refresh pacing, in nanoseconds from an arbitrary epoch.
+// StartMainLoop also reads Now() on the window thread to timestamp key changes
+class Clock {
+  public:
+    virtual ~Clock() = default;
+    virtual std::uint64_t Now() = 0;
+    // Blocks until Now() >= time; clocks that are not tied to the host return immediately
+    virtual void SleepUntil(std::uint64_t) {}
+    // Moves a clock that is not tied to the host forward one step; turbo calls it once per
+    // emulated frame since it runs frames without sleeping. Host clocks ignore it
+    virtual void Advance() {}
+};
+
+// Host monotonic time
+class WallClock : public Clock {
+  private:
+    std::chrono::steady_clock::time_point start;
+    std::uint64_t spinMargin;
+
+  public:
+    // A spin margin of 0 never spins, trading deadline precision for an idle CPU
+    WallClock(std::uint64_t spinMargin = SLEEP_SPIN_MARGIN)
+        : start(std::chrono::steady_clock::now()), spinMargin(spinMargin) {};
+    std::uint64_t Now() override {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    };
+    // Sleeps most of the way (scheduler wakeups are late by tens of microseconds), then spins to the deadline
+    void SleepUntil(std::uint64_t time) override {
+      std::uint64_t now = Now();
+      if (time > now + spinMargin)
+        std::this_thread::sleep_for(std::chrono::nanoseconds(time - now - spinMargin));
+      if (spinMargin)
+        while (Now() < time) {}
+    };
+};
+
+// Only moves by whole steps, on Advance or when slept on (a sleep jumps to the first step at or
+// after the deadline), so runs driven by it are reproducible no matter how fast the host is
+class VirtualClock : public Clock {
+  private:
+    std::atomic<std::uint64_t> steps;
+    std::uint64_t step;
+
+  public:
+    VirtualClock(std::uint64_t step) : steps(0), step(step) {};
+    std::uint64_t Now() override { return steps * step; };
+    void Advance() override { steps++; };
+    void SleepUntil(std::uint64_t time) override {
+      if (time > steps * step) steps = (time + step - 1) / step;
+    };
+};
+
+// Only moves when told to, for tests that need exact control over elapsed time
+class ManualClock : public Clock {
+  private:
+    std::atomic<std::uint64_t> time;
+
+  public:
+    ManualClock() : time(0) {};
+    using Clock::Advance;
+    void Set(std::uint64_t time) { this->time = time; };
+    void Advance(std::uint64_t nanoseconds) { time += nanoseconds; };
+    std::uint64_t Now() override { return time; };
+};
+
+#endif
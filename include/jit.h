@@ -0,0 +1,51 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include <cstddef>
+#include <initializer_list>
+
+#define JIT_CODE_CACHE_SIZE (1 << 20)
+#define JIT_MAX_BLOCK 32 // Instructions per compiled block
+#define JIT_MAX_INSTRUCTION_BYTES 32
+
+class Chip8;
+
+// Translates straight-line CHIP-8 blocks into x86-64 code (System V ABI).
+// Only register/ALU/I ops and jumps/skips are compiled; everything else
+// (calls, returns, Dxyn, key, timer and memory ops) ends the block and runs
+// through Chip8::EmulateCycle, which stays the reference implementation.
+class Jit {
+  private:
+    // Compiled code returns the next PC: Word block(Byte *V, Word *I)
+    typedef unsigned (*BlockFunction)(unsigned char *V, unsigned short *I);
+
+    struct Block {
+      BlockFunction code;
+      unsigned short start;
+      unsigned short end;    // One past the last byte translated
+      unsigned short length; // Instructions; 0 means "interpret this address"
+      unsigned short lastOpcode;
+    };
+
+    Chip8 *chip8;
+    unsigned char *codeCache;
+    std::size_t codeSize;
+    Block *blocks[4096];
+
+    void Interpret(unsigned long &cycles);
+    Block *Compile(unsigned short address);
+    bool EmitInstruction(unsigned short opcode, unsigned short address, bool &terminator);
+    void Emit(std::initializer_list<unsigned char> bytes);
+    void Emit16(unsigned short value);
+    void Emit32(unsigned value);
+    void Flush();
+
+  public:
+    Jit(Chip8 *chip8);
+    ~Jit();
+    void Run(unsigned long cycles);
+    void Invalidate(unsigned short address, unsigned short length);
+    bool Available() const { return codeCache != nullptr; };
+};
+
+#endif
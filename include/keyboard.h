@@ -0,0 +1,23 @@
+#ifndef KEYBOARD_H
+#define KEYBOARD_H
+
+#include <GLFW/glfw3.h>
+#include "peripherals.h"
+
+// Hex keypad kept up to date by a GLFW key callback (window thread only)
+class Keyboard : public InputDevice {
+  private:
+    GLFWwindow *window;
+    GLFWkeyfun previousCallback; // Chained so ImGui still sees every key
+    unsigned short held;         // Keys currently down
+    unsigned short tapped;       // Keys pressed since the last Keys call, so taps between reads are not lost
+
+    static void KeyCallback(GLFWwindow *window, int key, int scancode, int action, int mods);
+
+  public:
+    Keyboard(GLFWwindow *window);
+    ~Keyboard();
+    unsigned short Keys() override;
+};
+
+#endif
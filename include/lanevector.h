@@ -0,0 +1,74 @@
+#ifndef LANEVECTOR_H
+#define LANEVECTOR_H
+
+// Byte-lane SIMD helpers for the lockstep interpreter: AVX2 (32 lanes),
+// SSE2 (16 lanes) or a plain array fallback (16 lanes). Masks are 0xFF/0x00 per lane.
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define LANE_WIDTH 32
+typedef __m256i LaneVector;
+
+inline LaneVector LaneLoad(const unsigned char *p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)); }
+inline void LaneStore(unsigned char *p, LaneVector a) { _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), a); }
+inline LaneVector LaneSet(unsigned char value) { return _mm256_set1_epi8(static_cast<char>(value)); }
+inline LaneVector LaneAdd(LaneVector a, LaneVector b) { return _mm256_add_epi8(a, b); }
+inline LaneVector LaneSub(LaneVector a, LaneVector b) { return _mm256_sub_epi8(a, b); }
+inline LaneVector LaneSubSaturate(LaneVector a, LaneVector b) { return _mm256_subs_epu8(a, b); }
+inline LaneVector LaneAnd(LaneVector a, LaneVector b) { return _mm256_and_si256(a, b); }
+inline LaneVector LaneOr(LaneVector a, LaneVector b) { return _mm256_or_si256(a, b); }
+inline LaneVector LaneXor(LaneVector a, LaneVector b) { return _mm256_xor_si256(a, b); }
+inline LaneVector LaneEqual(LaneVector a, LaneVector b) { return _mm256_cmpeq_epi8(a, b); }
+inline LaneVector LaneMin(LaneVector a, LaneVector b) { return _mm256_min_epu8(a, b); }
+inline LaneVector LaneShiftRight1(LaneVector a) { return _mm256_and_si256(_mm256_srli_epi16(a, 1), _mm256_set1_epi8(0x7F)); }
+inline LaneVector LaneSelect(LaneVector mask, LaneVector a, LaneVector b) { return _mm256_blendv_epi8(a, b, mask); }
+
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define LANE_WIDTH 16
+typedef __m128i LaneVector;
+
+inline LaneVector LaneLoad(const unsigned char *p) { return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)); }
+inline void LaneStore(unsigned char *p, LaneVector a) { _mm_storeu_si128(reinterpret_cast<__m128i *>(p), a); }
+inline LaneVector LaneSet(unsigned char value) { return _mm_set1_epi8(static_cast<char>(value)); }
+inline LaneVector LaneAdd(LaneVector a, LaneVector b) { return _mm_add_epi8(a, b); }
+inline LaneVector LaneSub(LaneVector a, LaneVector b) { return _mm_sub_epi8(a, b); }
+inline LaneVector LaneSubSaturate(LaneVector a, LaneVector b) { return _mm_subs_epu8(a, b); }
+inline LaneVector LaneAnd(LaneVector a, LaneVector b) { return _mm_and_si128(a, b); }
+inline LaneVector LaneOr(LaneVector a, LaneVector b) { return _mm_or_si128(a, b); }
+inline LaneVector LaneXor(LaneVector a, LaneVector b) { return _mm_xor_si128(a, b); }
+inline LaneVector LaneEqual(LaneVector a, LaneVector b) { return _mm_cmpeq_epi8(a, b); }
+inline LaneVector LaneMin(LaneVector a, LaneVector b) { return _mm_min_epu8(a, b); }
+inline LaneVector LaneShiftRight1(LaneVector a) { return _mm_and_si128(_mm_srli_epi16(a, 1), _mm_set1_epi8(0x7F)); }
+inline LaneVector LaneSelect(LaneVector mask, LaneVector a, LaneVector b) {
+  return _mm_or_si128(_mm_and_si128(mask, b), _mm_andnot_si128(mask, a));
+}
+
+#else
+#define LANE_WIDTH 16
+struct LaneVector { unsigned char v[LANE_WIDTH]; };
+
+#define LANE_MAP(expression) \
+  LaneVector r; for (int i = 0; i < LANE_WIDTH; i++) r.v[i] = (expression); return r;
+inline LaneVector LaneLoad(const unsigned char *p) { LANE_MAP(p[i]) }
+inline void LaneStore(unsigned char *p, LaneVector a) { for (int i = 0; i < LANE_WIDTH; i++) p[i] = a.v[i]; }
+inline LaneVector LaneSet(unsigned char value) { LANE_MAP(value) }
+inline LaneVector LaneAdd(LaneVector a, LaneVector b) { LANE_MAP(a.v[i] + b.v[i]) }
+inline LaneVector LaneSub(LaneVector a, LaneVector b) { LANE_MAP(a.v[i] - b.v[i]) }
+inline LaneVector LaneSubSaturate(LaneVector a, LaneVector b) { LANE_MAP(a.v[i] > b.v[i] ? a.v[i] - b.v[i] : 0) }
+inline LaneVector LaneAnd(LaneVector a, LaneVector b) { LANE_MAP(a.v[i] & b.v[i]) }
+inline LaneVector LaneOr(LaneVector a, LaneVector b) { LANE_MAP(a.v[i] | b.v[i]) }
+inline LaneVector LaneXor(LaneVector a, LaneVector b) { LANE_MAP(a.v[i] ^ b.v[i]) }
+inline LaneVector LaneEqual(LaneVector a, LaneVector b) { LANE_MAP(a.v[i] == b.v[i] ? 0xFF : 0x00) }
+inline LaneVector LaneMin(LaneVector a, LaneVector b) { LANE_MAP(a.v[i] < b.v[i] ? a.v[i] : b.v[i]) }
+inline LaneVector LaneShiftRight1(LaneVector a) { LANE_MAP(a.v[i] >> 1) }
+inline LaneVector LaneSelect(LaneVector mask, LaneVector a, LaneVector b) { LANE_MAP(mask.v[i] ? b.v[i] : a.v[i]) }
+#undef LANE_MAP
+#endif
+
+// Unsigned a > b, as a lane mask
+inline LaneVector LaneGreater(LaneVector a, LaneVector b) {
+  return LaneXor(LaneEqual(LaneMin(a, b), a), LaneSet(0xFF));
+}
+
+#endif
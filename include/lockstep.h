@@ -0,0 +1,87 @@
+#ifndef LOCKSTEP_H
+#define LOCKSTEP_H
+
+#include <memory>
+#include <vector>
+#include "batch.h"
+#include "chip8.h"
+
+// Steps many instances of one ROM together. Registers, I, timers, keypad, stack,
+// RNG and display are kept in structure-of-arrays form, and lanes sharing a PC form a group that stays put
+// until a branch sends its lanes different ways (groups meeting at one PC merge
+// again). Each group decodes its instruction once; register-only opcodes run as
+// masked SIMD kernels over the group's own lanes (groups narrower than a vector,
+// and every other opcode, run lane by lane on the same arrays plus the memory
+// of the lane's Chip8), mirroring the interpreter. Loops that only wait
+// for the next frame park their group until it ends, as Chip8::SkipIdleLoop does.
+class Chip8Lockstep {
+  private:
+    struct LaneGroup {
+      Word pc;
+      bool parked;                     // Idle until the end of the frame
+      bool maskValid;                  // mask and chunks match lanes
+      std::vector<std::size_t> lanes;  // Ascending
+      std::vector<Byte> mask;          // 0xFF for member lanes, paddedLanes long
+      std::vector<std::size_t> chunks; // First lane of every LANE_WIDTH chunk holding a member
+    };
+
+    std::size_t lanes;
+    std::size_t paddedLanes; // Rounded up to a multiple of LANE_WIDTH
+    unsigned long instructionsPerFrame;
+    std::vector<std::unique_ptr<Chip8>> instances;
+
+    // Structure of Arrays
+    std::vector<Byte> V[16];
+    std::vector<Word> I;
+    std::vector<Byte> delayTimer;
+    std::vector<Byte> soundTimer;
+    std::vector<Word> keys;
+    std::vector<Word> stack; // 16 per lane
+    std::vector<Byte> sp;
+    std::vector<Random> random;
+    std::vector<std::uint64_t> display; // DISPLAY_HEIGHT rows per lane
+
+    // Lane Groups
+    std::vector<LaneGroup> active;
+    std::vector<LaneGroup> spare;      // Emptied groups, kept so splits reuse their buffers
+    unsigned long stepsLeft;           // Steps left in the current frame after the executing one
+    Byte written[MEMORY];              // Addresses some lane has stored to, where lanes' memory may differ
+
+    // Scratch
+    std::vector<Word> nextPC;          // Per member of the executing group
+    std::vector<Byte> nextParked;
+    std::vector<std::uint32_t> outcomeGroup; // (pc, parked) -> group index + 1
+    std::vector<std::size_t> merged;
+    std::vector<Byte> condition;
+
+    // Statistics
+    unsigned long long vectorLaneOps;
+    unsigned long long scalarLaneOps;
+    unsigned long long groups;
+
+    std::size_t NewGroup(Word pc, bool parked);
+    void Prepare(LaneGroup &group);
+    void ExecuteGroup(std::size_t g);
+    void ExecuteVector(LaneGroup &group, Word opcode);
+    Word ExecuteScalar(std::size_t lane, Word pc, Word opcode, Byte operation);
+    void IdlePoll(std::size_t g, Word target);
+    void MarkWritten(Word address, Word length);
+    const Byte *LaneMemory(std::size_t lane, Word address, Word length) const;
+    void Split(std::size_t g);
+    void Merge();
+
+  public:
+    Chip8Lockstep(std::size_t lanes, unsigned long instructionsPerFrame);
+    int LoadROM(const char *romPath);
+    void Seed(std::size_t lane, std::uint64_t seed);
+    void SetKeys(std::size_t lane, Word keys);
+    void Step();
+    void RunFrames(unsigned long frames);
+    std::size_t Lanes() const { return lanes; };
+    const std::uint64_t *GetDisplay(std::size_t lane) const { return &display[lane * DISPLAY_HEIGHT]; };
+    unsigned long long VectorLaneOps() const { return vectorLaneOps; };
+    unsigned long long ScalarLaneOps() const { return scalarLaneOps; };
+    unsigned long long Groups() const { return groups; };
+};
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef MAILBOX_H
+#define MAILBOX_H
+
+#include <atomic>
+
+// Triple buffer handing the newest value from one producer thread to one consumer thread
+// without locks. The producer fills Back() and publishes it; the consumer takes the latest
+// published slot and reads Front() until its next Take. Neither side ever waits, and values
+// the consumer was too slow to take are simply replaced.
+template <typename T>
+class Mailbox {
+  private:
+    static constexpr unsigned SLOT = 3;  // Slot index bits of middle
+    static constexpr unsigned FRESH = 4; // Set while middle holds a value the consumer has not taken
+
+    T slots[3];
+    unsigned back;                // Owned by the producer
+    std::atomic<unsigned> middle; // Last published slot
+    unsigned front;               // Owned by the consumer
+
+  public:
+    Mailbox() : slots(), back(0), middle(1), front(2) {};
+
+    // Producer
+    T &Back() { return slots[back]; };
+    void Publish() { back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & SLOT; };
+
+    // Consumer (false when nothing was published since the last Take)
+    bool Take() {
+      if (!(middle.load(std::memory_order_relaxed) & FRESH))
+        return false;
+      front = middle.exchange(front, std::memory_order_acq_rel) & SLOT;
+      return true;
+    };
+    const T &Front() const { return slots[front]; };
+};
+
+#endif
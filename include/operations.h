@@ -0,0 +1,16 @@
+#ifndef OPERATIONS_H
+#define OPERATIONS_H
+
+// Every concrete operation, in the order of the Operations enum and handler tables
+#define CHIP8_OPERATIONS(X) \
+  X(00E0) X(00EE) X(1nnn) X(2nnn) X(3xnn) X(4xnn) X(5xy0) X(6xnn) X(7xnn) \
+  X(8xy0) X(8xy1) X(8xy2) X(8xy3) X(8xy4) X(8xy5) X(8xy6) X(8xy7) X(8xyE) \
+  X(9xy0) X(Annn) X(Bnnn) X(Cxnn) X(Dxyn) X(Ex9E) X(ExA1) \
+  X(Fx07) X(Fx0A) X(Fx15) X(Fx18) X(Fx1E) X(Fx29) X(Fx33) X(Fx55) X(Fx65) \
+  X(Unknown)
+
+#define CHIP8_OPERATION_ENUM(name) OP_##name,
+typedef enum { CHIP8_OPERATIONS(CHIP8_OPERATION_ENUM) OP_COUNT } Operations;
+#undef CHIP8_OPERATION_ENUM
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef PERIPHERALS_H
+#define PERIPHERALS_H
+
+#include <cstdint>
+#include "spscqueue.h"
+
+// Video output attached to a Chip8 core (e.g. Screen)
+class VideoDevice {
+  public:
+    virtual ~VideoDevice() = default;
+    virtual void Draw() = 0;
+    virtual bool IsOpen() = 0;
+    // Blocks until input arrives or the timeout (nanoseconds) passes (used while paused or waiting for a key)
+    virtual void WaitEvents(std::uint64_t) {}
+};
+
+// Audio output attached to a Chip8 core (e.g. Buzzer)
+class AudioDevice {
+  public:
+    virtual ~AudioDevice() = default;
+    virtual void Play() = 0;
+    virtual void Stop() = 0;
+};
+
+// Hex keypad source attached to a Chip8 core (e.g. Keyboard)
+class InputDevice {
+  public:
+    virtual ~InputDevice() = default;
+    // Bit n is set while hex key n is held
+    virtual unsigned short Keys() = 0;
+};
+
+// Keypad driven by a script or replay instead of a window
+class ScriptedInput : public InputDevice {
+  private:
+    unsigned short keys;
+
+  public:
+    ScriptedInput() : keys(0) {};
+    void SetKeys(unsigned short keys) { this->keys = keys; };
+    unsigned short Keys() override { return keys; };
+};
+
+// Carries the keypad from the window thread to the emulation thread. Poll samples the source
+// (which may only be read on the window thread) and queues every change with the host time it
+// was seen at; the emulation thread applies them one at a time with Update, at the instruction
+// that time falls on, so a press and release sampled back to back are both seen by the ROM.
+class InputQueue : public InputDevice {
+  private:
+    struct KeyChange {
+      unsigned short keys;
+      std::uint64_t time;
+    };
+
+    InputDevice *source;
+    unsigned short polled; // Last state queued by Poll
+    unsigned short keys;   // State seen by the core
+    SpscQueue<KeyChange, 64> changes;
+
+  public:
+    InputQueue() : source(nullptr), polled(0), keys(0) {};
+    void SetSource(InputDevice *source) { this->source = source; };
+    // True when a change was queued
+    bool Poll(std::uint64_t time) {
+      unsigned short state = source ? source->Keys() : 0;
+      if (state == polled || !changes.Push({ state, time }))
+        return false;
+      polled = state;
+      return true;
+    };
+    // Host time of the oldest change not applied yet; false when none is queued
+    bool Pending(std::uint64_t &time) const {
+      KeyChange change;
+      if (!changes.Peek(change))
+        return false;
+      time = change.time;
+      return true;
+    };
+    void Update() {
+      KeyChange change;
+      if (changes.Pop(change))
+        keys = change.keys;
+    };
+    unsigned short Keys() override { return keys; };
+};
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <cstdint>
+#include <cstdio>
+#include "operations.h"
+#if defined(CHIP8_PROFILE_TIMING) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+#define PROFILE_BUCKETS 16 // Bucket b counts handler costs in [2^b, 2^(b+1)) ticks, the last one is open-ended
+#define PROFILE_ADDRESSES 4096 // One fetch counter per byte of Chip-8 memory
+#define PROFILE_HOT_ADDRESSES 16 // Entries in the hot address list
+
+// Timestamp for handler cost sampling: TSC ticks on x86, steady_clock nanoseconds elsewhere
+inline std::uint64_t ProfileTimestamp() {
+#if defined(CHIP8_PROFILE_TIMING) && (defined(__x86_64__) || defined(__i386__))
+  return __rdtsc();
+#else
+  return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+// Executions per concrete operation and, when timed, a log2 histogram of their cost,
+// plus how often each address was fetched from
+class Profile {
+  private:
+    unsigned long long counts[OP_COUNT];
+    unsigned long long samples[OP_COUNT]; // Timed executions; fast-forwarded ones are counted but not timed
+    unsigned long long ticks[OP_COUNT];
+    unsigned long long histogram[OP_COUNT][PROFILE_BUCKETS];
+    unsigned long long visits[PROFILE_ADDRESSES];
+    unsigned long long fastForwarded;
+
+  public:
+    Profile() { Clear(); };
+    void Clear();
+
+    void Count(int operation) { counts[operation]++; };
+    void Visit(int address) { visits[address]++; };
+    void Sample(int operation, std::uint64_t cost) {
+      int bucket = 0;
+      counts[operation]++;
+      samples[operation]++;
+      ticks[operation] += cost;
+      while (cost > 1 && bucket < PROFILE_BUCKETS - 1) {
+        cost >>= 1;
+        bucket++;
+      }
+      histogram[operation][bucket]++;
+    };
+    // Instructions an idle loop or Fx0A wait skipped instead of executing
+    void FastForward(int operation, int address, unsigned long long times) {
+      counts[operation] += times;
+      visits[address] += times;
+      fastForwarded += times;
+    };
+
+    unsigned long long Count(int operation) const { return counts[operation]; };
+    unsigned long long Samples(int operation) const { return samples[operation]; };
+    unsigned long long Ticks(int operation) const { return ticks[operation]; };
+    const unsigned long long *Histogram(int operation) const { return histogram[operation]; };
+    unsigned long long Visits(int address) const { return visits[address]; };
+    unsigned long long FastForwarded() const { return fastForwarded; };
+    unsigned long long Total() const;
+    unsigned long long MaxVisits() const;
+    int HotAddresses(int *addresses, int count) const;
+    void Dump(std::FILE *out) const;
+};
+
+// "8xy4" for OP_8xy4
+const char *OperationName(int operation);
+// Opcode class (high nibble) of an operation, or -1 for OP_Unknown
+int OperationClass(int operation);
+
+#endif
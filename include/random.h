@@ -0,0 +1,39 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <cstdint>
+
+// xoshiro128** generator; each Chip8 owns one so runs are reproducible from a seed
+struct Random {
+  std::uint32_t state[4];
+
+  static std::uint32_t Rotate(std::uint32_t value, int count) {
+    return (value << count) | (value >> (32 - count));
+  };
+
+  // Expands a 64-bit seed with splitmix64, which never yields the all-zero state
+  void Seed(std::uint64_t seed) {
+    for (int i = 0; i < 4; i += 2) {
+      std::uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+      z ^= z >> 31;
+      state[i] = static_cast<std::uint32_t>(z);
+      state[i + 1] = static_cast<std::uint32_t>(z >> 32);
+    }
+  };
+
+  std::uint32_t Next() {
+    std::uint32_t result = Rotate(state[1] * 5, 7) * 9;
+    std::uint32_t t = state[1] << 9;
+    state[2] ^= state[0];
+    state[3] ^= state[1];
+    state[1] ^= state[2];
+    state[0] ^= state[3];
+    state[2] ^= t;
+    state[3] = Rotate(state[3], 11);
+    return result;
+  };
+};
+
+#endif
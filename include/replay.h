@@ -0,0 +1,59 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Replay file layout (little-endian):
+//
+//   offset  size  field
+//        0     4  magic "C8RP"
+//        4     2  version
+//        6     2  reserved (0)
+//        8     8  RNG seed
+//       16     8  ROM hash (FNV-1a of the ROM bytes)
+//       24     8  cycles recorded
+//       32     8  state hash at the end of the recording
+//       40     -  events until end of file
+//
+// Each event is a LEB128 varint of (cycles since the previous event << 1 | is key change);
+// a key change is followed by the new 16-bit key mask, otherwise the event is a timer tick.
+#define REPLAY_MAGIC "C8RP"
+#define REPLAY_VERSION 1
+#define REPLAY_HEADER_SIZE 40
+
+struct ReplayEvent {
+  std::uint64_t cycle;
+  bool keyChange;
+  unsigned short keys;
+};
+
+// Everything a Chip8 observes from the outside between LoadROM and the end of a
+// session: key mask changes at the cycle ProcessInput saw them, and timer ticks
+class Replay {
+  private:
+    std::vector<unsigned char> events;
+    std::uint64_t lastCycle;
+    unsigned short lastKeys;
+
+    void PutEvent(std::uint64_t cycle, bool keyChange);
+
+  public:
+    std::uint64_t seed;
+    std::uint64_t romHash;
+    std::uint64_t cycles;
+    std::uint64_t stateHash;
+
+    Replay();
+    void Begin(std::uint64_t seed, std::uint64_t romHash);
+    void RecordKeys(std::uint64_t cycle, unsigned short keys);
+    void RecordTick(std::uint64_t cycle);
+    void End(std::uint64_t cycles, std::uint64_t stateHash);
+    std::vector<ReplayEvent> Events() const;
+    std::size_t Bytes() const { return REPLAY_HEADER_SIZE + events.size(); };
+    bool Save(const char *path) const;
+    bool Load(const char *path);
+};
+
+#endif
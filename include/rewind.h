@@ -0,0 +1,47 @@
+#ifndef REWIND_H
+#define REWIND_H
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+#define REWIND_SNAPSHOTS 600         // 10 s of 60 Hz frames
+#define REWIND_KEYFRAME_INTERVAL 60  // Snapshots per keyframe group
+
+// Ring of fixed-size state snapshots. Every REWIND_KEYFRAME_INTERVAL-th snapshot
+// is a keyframe; the ones in between are stored as the XOR against their keyframe.
+// Both kinds are run-length encoded, so a frame that changed little costs a few bytes.
+class Rewind {
+  private:
+    struct Snapshot {
+      std::vector<unsigned char> data;
+      bool keyframe;
+    };
+
+    std::size_t stateSize;
+    std::size_t capacity;
+    std::size_t keyframeInterval;
+    std::deque<Snapshot> snapshots;
+    std::vector<unsigned char> keyframe; // Decoded keyframe of the newest group
+    std::vector<unsigned char> scratch;
+    std::size_t sinceKeyframe;
+    std::size_t bytes;
+
+    void Evict();
+
+  public:
+    Rewind(std::size_t stateSize, std::size_t capacity, std::size_t keyframeInterval);
+    void Clear();
+    void Push(const unsigned char *state);
+    // Removes the newest snapshot and decodes it into state; false when the ring is empty
+    bool Pop(unsigned char *state);
+    std::size_t Size() const { return snapshots.size(); };
+    std::size_t Bytes() const { return bytes; };
+};
+
+// PackBits-style run-length coding: a control byte c < 128 repeats the next byte
+// c + 1 times, c >= 128 is followed by c - 127 literal bytes
+void RunLengthEncode(const unsigned char *source, std::size_t size, std::vector<unsigned char> &out);
+void RunLengthDecode(const unsigned char *source, std::size_t size, unsigned char *out, std::size_t outSize);
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef SAVESTATE_H
+#define SAVESTATE_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Save state layout (all multi-byte fields little-endian, no padding):
+//
+//   offset  size  field
+//        0     4  magic "C8ST"
+//        4     2  version
+//        6     2  total size in bytes
+//        8  4096  memory
+//     4104    16  V[0..F]
+//     4120    16  key[0..F]
+//     4136     2  I
+//     4138     2  pc
+//     4140    32  stack[0..15]
+//     4172     1  sp
+//     4173     1  delay timer
+//     4174     1  sound timer
+//     4175     1  key pressed (0xFF when none)
+//     4176   256  display rows (pixel x of a row is bit 63 - x)
+//     4432    16  random generator state[0..3]
+//     4448     8  cycles executed since reset
+//     4456     1  frame phase (frame within the current second)
+#define STATE_MAGIC "C8ST"
+#define STATE_VERSION 4
+#define STATE_SIZE 4457
+
+// Little-endian field access, independent of the host byte order
+inline void StatePut16(unsigned char *p, std::uint16_t value) {
+  p[0] = value & 0xFF;
+  p[1] = value >> 8;
+}
+
+inline std::uint16_t StateGet16(const unsigned char *p) {
+  return p[0] | (p[1] << 8);
+}
+
+inline void StatePut32(unsigned char *p, std::uint32_t value) {
+  for (int i = 0; i < 4; i++) p[i] = (value >> (i * 8)) & 0xFF;
+}
+
+inline std::uint32_t StateGet32(const unsigned char *p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<std::uint32_t>(p[3]) << 24);
+}
+
+inline void StatePut64(unsigned char *p, std::uint64_t value) {
+  for (int i = 0; i < 8; i++) p[i] = (value >> (i * 8)) & 0xFF;
+}
+
+inline std::uint64_t StateGet64(const unsigned char *p) {
+  std::uint64_t value = 0;
+  for (int i = 0; i < 8; i++) value |= static_cast<std::uint64_t>(p[i]) << (i * 8);
+  return value;
+}
+
+#endif
@@ -9,15 +9,15 @@
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
 #include "shader.h"
+#include "chip8.h"
+#include "peripherals.h"
 
-#define DISPLAY_WIDTH 64
-#define DISPLAY_HEIGHT 32
 #define WIDTH 1920
 #define HEIGHT 960
+#define MEMORY_ROW_BYTES 16   // Bytes per Memory window row
+#define MEMORY_FADE_FRAMES 30 // Draws a written byte stays highlighted in the Memory window
 
-class Chip8;
-
-class Screen {
+class Screen : public VideoDevice {
   private:
     GLuint texture;
     GLuint VAO;
@@ -25,21 +25,30 @@ class Screen {
     GLuint RBO;
     GLuint FBOtexture;
     std::vector<unsigned char> *textureData;
+    std::uint64_t shownRows[DISPLAY_HEIGHT]; // Display rows the texture currently holds
     std::unique_ptr<Shader> shader;
     Chip8 *chip8;
-    std::vector<std::string> debugLog;
+
+    // Memory Window
+    unsigned char previousMemory[MEMORY]; // Memory as of the previous draw
+    unsigned long changedAt[MEMORY];      // Draw a byte was last seen changing at (0 = never)
+    unsigned long draws;
+
+    unsigned long long uiAllocations; // Heap allocations made while building the previous frame
 
     void MenuBar();
     void Debugger();
-    void UpdateTextureData();
+    void UpdateTextureData(std::uint32_t rows);
+    void UploadRows(std::uint32_t rows);
 
   public:
     GLFWwindow *window;
 
     Screen(const char *vsPath, const char *fsPath, Chip8 *chip8);
     ~Screen();
-    void Draw();
-    void PushToLog(std::string entry);
+    void Draw() override;
+    bool IsOpen() override;
+    void WaitEvents(std::uint64_t timeout) override;
 };
 
 #endif
@@ -0,0 +1,49 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+// Bounded lock-free ring for exactly one producer thread and one consumer thread.
+// Push fails instead of blocking when the ring is full.
+template <typename T, std::size_t Capacity>
+class SpscQueue {
+  static_assert((Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+  private:
+    T items[Capacity];
+    alignas(64) std::atomic<std::size_t> head; // Next item to pop, written by the consumer
+    alignas(64) std::atomic<std::size_t> tail; // Next free slot, written by the producer
+
+  public:
+    SpscQueue() : items(), head(0), tail(0) {};
+
+    bool Push(const T &item) {
+      std::size_t slot = tail.load(std::memory_order_relaxed);
+      if (slot - head.load(std::memory_order_acquire) == Capacity)
+        return false;
+      items[slot & (Capacity - 1)] = item;
+      tail.store(slot + 1, std::memory_order_release);
+      return true;
+    };
+
+    // Copies the oldest item without removing it (consumer side)
+    bool Peek(T &item) const {
+      std::size_t slot = head.load(std::memory_order_relaxed);
+      if (slot == tail.load(std::memory_order_acquire))
+        return false;
+      item = items[slot & (Capacity - 1)];
+      return true;
+    };
+
+    bool Pop(T &item) {
+      std::size_t slot = head.load(std::memory_order_relaxed);
+      if (slot == tail.load(std::memory_order_acquire))
+        return false;
+      item = items[slot & (Capacity - 1)];
+      head.store(slot + 1, std::memory_order_release);
+      return true;
+    };
+};
+
+#endif
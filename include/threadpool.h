@@ -0,0 +1,44 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool where every worker owns a task deque: it pops from the back of
+// its own deque and steals from the front of the others' when it runs dry.
+class ThreadPool {
+  private:
+    struct Queue {
+      std::mutex mutex;
+      std::deque<std::function<void(unsigned)>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<unsigned> nextQueue;
+    std::atomic<long> queued;          // Submitted but not yet picked up
+    unsigned long pending;             // Submitted but not yet finished (guarded by stateMutex)
+    std::mutex stateMutex;
+    std::condition_variable taskAvailable;
+    std::condition_variable tasksDone;
+    bool stopping;
+
+    void WorkerLoop(unsigned index);
+    bool PopTask(unsigned index, std::function<void(unsigned)> &task);
+
+  public:
+    ThreadPool(unsigned threads);
+    ~ThreadPool();
+    unsigned Size() const { return workers.size(); };
+    // Tasks receive the index of the worker running them
+    void Submit(std::function<void(unsigned)> task);
+    void Wait();
+};
+
+#endif
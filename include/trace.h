@@ -0,0 +1,75 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstddef>
+#include <cstring>
+
+#define TRACE_SIZE 128 // Must be a power of two
+
+typedef enum {
+  TRACE_SKIPPED = 1 << 0, // Next instruction was skipped
+  TRACE_STALLED = 1 << 1, // PC did not advance (Fx0A waiting, stack underflow)
+  TRACE_IDLE = 1 << 2,    // Idle loop or Fx0A wait: the rest of the RunCycles call was fast-forwarded
+} TraceFlags;
+
+// One executed instruction; text is only produced by FormatTrace when it is displayed
+struct TraceEntry {
+  unsigned short pc;
+  unsigned short nextPC;
+  unsigned short opcode;
+  unsigned short I;
+  unsigned char V[16];
+  unsigned char delayTimer;
+  unsigned char soundTimer;
+  unsigned char sp;
+  unsigned char flags;
+  unsigned long idleCycles; // Instructions fast-forwarded after this one (TRACE_IDLE)
+};
+
+class TraceBuffer {
+  private:
+    TraceEntry entries[TRACE_SIZE];
+    std::size_t head;
+    std::size_t count;
+
+  public:
+    TraceBuffer() : head(0), count(0) {};
+
+    void Clear() { head = 0; count = 0; };
+    std::size_t Size() const { return count; };
+
+    // Index 0 is the oldest entry still held
+    const TraceEntry &operator[](std::size_t i) const {
+      return entries[(head - count + i) & (TRACE_SIZE - 1)];
+    };
+
+    void Push(unsigned short pc, unsigned short nextPC, unsigned short opcode, unsigned short I,
+              const unsigned char *V, unsigned char delayTimer, unsigned char soundTimer, unsigned char sp) {
+      TraceEntry &entry = entries[head];
+      entry.pc = pc;
+      entry.nextPC = nextPC;
+      entry.opcode = opcode;
+      entry.I = I;
+      std::memcpy(entry.V, V, 16);
+      entry.delayTimer = delayTimer;
+      entry.soundTimer = soundTimer;
+      entry.sp = sp;
+      entry.flags = (nextPC == pc + 4 ? TRACE_SKIPPED : 0) | (nextPC == pc ? TRACE_STALLED : 0);
+      entry.idleCycles = 0;
+      head = (head + 1) & (TRACE_SIZE - 1);
+      if (count < TRACE_SIZE) count++;
+    };
+
+    // Notes on the newest entry that the instructions after it were fast-forwarded
+    void MarkIdle(unsigned long cycles) {
+      if (count == 0) return;
+      TraceEntry &entry = entries[(head - 1) & (TRACE_SIZE - 1)];
+      entry.flags |= TRACE_IDLE;
+      entry.idleCycles = cycles;
+    };
+};
+
+// Writes the log line for an entry into buffer, truncated to fit; returns the number of characters stored
+int FormatTrace(const TraceEntry &entry, char *buffer, std::size_t size);
+
+#endif
@@ -1,11 +1,64 @@
-#include <string>
-#include <sstream>
-#include <iomanip>
+#ifndef UTILITIES_H
+#define UTILITIES_H
+
+#include <array>
+#include <cstddef>
 
 namespace Utilities {
-  std::string FormatHex(int fillWidth, auto value) {
-    std::stringstream hexStream; 
-    hexStream << "0x" << std::hex << std::uppercase << std::setfill('0') << std::setw(fillWidth) << value;
-    return hexStream.str();
+  constexpr char hexDigits[] = "0123456789ABCDEF";
+
+  // Two uppercase hex digits for every byte value, built at compile time
+  constexpr std::array<std::array<char, 2>, 256> hexBytes = [] {
+    std::array<std::array<char, 2>, 256> table = {};
+    for (int i = 0; i < 256; i++) table[i] = { hexDigits[i >> 4], hexDigits[i & 0xF] };
+    return table;
+  }();
+
+  // Text line in a fixed-size buffer, so per-frame debugger labels never touch the heap.
+  // Appends that do not fit are truncated.
+  template <std::size_t Capacity>
+  class FixedString {
+    private:
+      char text[Capacity];
+      std::size_t length;
+
+      constexpr void Put(char c) {
+        if (length < Capacity - 1) text[length++] = c;
+        text[length] = '\0';
+      };
+
+    public:
+      constexpr FixedString() : text(), length(0) {};
+      constexpr FixedString(const char *prefix) : FixedString() { Append(prefix); };
+
+      constexpr FixedString &Append(const char *suffix) {
+        while (*suffix) Put(*suffix++);
+        return *this;
+      };
+      // "0x" followed by exactly digits hex digits of value
+      constexpr FixedString &Hex(unsigned value, int digits) {
+        Put('0');
+        Put('x');
+        for (int shift = (digits - 1) * 4; shift >= 0; shift -= 4) Put(hexDigits[(value >> shift) & 0xF]);
+        return *this;
+      };
+      constexpr FixedString &Decimal(long value) {
+        char digits[20];
+        int count = 0;
+        unsigned long magnitude = value < 0 ? 0UL - value : value;
+        if (value < 0) Put('-');
+        do {
+          digits[count++] = '0' + magnitude % 10;
+          magnitude /= 10;
+        } while (magnitude);
+        while (count) Put(digits[--count]);
+        return *this;
+      };
+
+      const char *Begin() const { return text; };
+      const char *End() const { return text + length; };
+      std::size_t Length() const { return length; };
   };
 }
+
+#endif
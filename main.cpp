@@ -1,11 +1,41 @@
 // External Libraries
 #include "chip8.h"
+#include "screen.h"
+#include "buzzer.h"
+#include "keyboard.h"
+#include <cstring>
+#include <ctime>
+#include <iostream>
 
 int main(int argc, char **argv) {
   // Chip8
-  Chip8 chip8(16, 0);
-  chip8.LoadROM("../roms/chip8Logo.ch8");
+  Chip8 chip8(DEFAULT_IPS, 0);
+  // The window presents at vsync, so frame pacing needs no sub-millisecond spin before each deadline
+  WallClock clock(0);
+  Replay replay;
+  const char *recordPath = argc > 3 && std::strcmp(argv[2], "--record") == 0 ? argv[3] : nullptr;
+  chip8.Seed(time(NULL));
+  if (recordPath) chip8.StartRecording(&replay);
+
+  // Frontend
+  Screen screen("../vertexShader.glsl", "../fragmentShader.glsl", &chip8);
+  Buzzer buzzer;
+  Keyboard keyboard(screen.window);
+  chip8.AttachVideo(&screen);
+  chip8.AttachAudio(&buzzer);
+  chip8.AttachInput(&keyboard);
+  chip8.AttachClock(&clock);
+
+  chip8.LoadROM(argc > 1 ? argv[1] : "../roms/chip8Logo.ch8");
   chip8.StartMainLoop();
 
+  chip8.DumpProfile(stderr);
+
+  // Recording
+  if (recordPath) {
+    chip8.StopRecording();
+    if (!replay.Save(recordPath)) std::cerr << "Could not write replay " << recordPath << "\n";
+  }
+
   return 0;
 }
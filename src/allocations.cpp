@@ -0,0 +1,57 @@
+#include "allocations.h"
+#include <cstdlib>
+#include <new>
+
+static thread_local unsigned long long allocations = 0;
+
+unsigned long long ThreadAllocations() {
+  return allocations;
+}
+
+void *CountedAlloc(std::size_t size, void *) {
+  allocations++;
+  return std::malloc(size);
+}
+
+void CountedFree(void *pointer, void *) {
+  std::free(pointer);
+}
+
+#ifdef CHIP8_COUNT_ALLOCATIONS
+// Replaced global allocation functions (over-aligned allocations keep the library versions and are not counted)
+void *operator new(std::size_t size) {
+  allocations++;
+  if (void *pointer = std::malloc(size ? size : 1))
+    return pointer;
+  throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) {
+  return operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  allocations++;
+  return std::malloc(size ? size : 1);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  return operator new(size, std::nothrow);
+}
+
+void operator delete(void *pointer) noexcept {
+  std::free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept {
+  std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+#endif
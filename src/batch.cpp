@@ -0,0 +1,181 @@
+#include "batch.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+// FNV-1a over the packed framebuffer rows, least significant byte first
+static unsigned long long HashDisplay(const std::uint64_t *display) {
+  unsigned long long hash = 14695981039346656037ULL;
+  for (int row = 0; row < DISPLAY_HEIGHT; row++) {
+    for (int byte = 0; byte < 8; byte++) {
+      hash ^= (display[row] >> (byte * 8)) & 0xFF;
+      hash *= 1099511628211ULL;
+    }
+  }
+  return hash;
+}
+
+// Whole-field unsigned parse; "0x" selects hex. Never throws, since scripts are read inside pool workers
+static bool ParseNumber(const std::string &text, unsigned long &value) {
+  const char *first = text.data();
+  const char *last = first + text.size();
+  int base = 10;
+  if (text.size() > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) {
+    first += 2;
+    base = 16;
+  }
+  auto [end, error] = std::from_chars(first, last, value, base);
+  return error == std::errc() && end == last && first != last;
+}
+
+int Batch::LoadManifest(const char *manifestPath) {
+  std::ifstream manifest(manifestPath);
+  std::string line;
+  fs::path base = fs::path(manifestPath).parent_path();
+  int lineNumber = 0;
+
+  if (!manifest.is_open())
+    return 0;
+
+  // Paths in the manifest are relative to the manifest itself
+  auto resolve = [&](const std::string &path) {
+    if (path == "-" || fs::path(path).is_absolute()) return path;
+    return (base / path).string();
+  };
+
+  while (std::getline(manifest, line)) {
+    std::istringstream fields(line);
+    std::string rom, script, budget, frequencyField;
+    unsigned long frequency = 16;
+    BatchJob job;
+    lineNumber++;
+
+    if (!(fields >> rom) || rom[0] == '#')
+      continue;
+    if (!(fields >> script >> budget) || budget.size() < 2 || (budget.back() != 'f' && budget.back() != 'c')) {
+      std::cerr << manifestPath << ":" << lineNumber << ": expected <rom> <script|-> <count>f|<count>c\n";
+      return 0;
+    }
+
+    job.romPath = resolve(rom);
+    job.scriptPath = resolve(script);
+    job.error = ParseNumber(budget.substr(0, budget.size() - 1), job.budget) ? nullptr : "bad budget";
+    if (fields >> frequencyField && (!ParseNumber(frequencyField, frequency) || frequency == 0) && !job.error)
+      job.error = "bad instructions per frame";
+    job.budgetInFrames = budget.back() == 'f';
+    job.instructionsPerFrame = std::clamp<unsigned long>(frequency, 1, MAX_IPS / FRAME_RATE);
+    jobs.push_back(job);
+  }
+  return 1;
+}
+
+bool Batch::LoadScript(const std::string &scriptPath, std::vector<InputEvent> &events) {
+  std::ifstream script(scriptPath);
+  std::string line;
+
+  if (scriptPath == "-")
+    return true;
+  if (!script.is_open())
+    return false;
+
+  while (std::getline(script, line)) {
+    std::istringstream fields(line);
+    InputEvent event;
+    std::string keys;
+    unsigned long mask;
+    if (!(fields >> event.frame >> keys) || line[0] == '#')
+      continue;
+    if (!ParseNumber(keys, mask) || mask > 0xFFFF)
+      return false;
+    event.keys = mask;
+    events.push_back(event);
+  }
+  std::stable_sort(events.begin(), events.end(), [](const InputEvent &a, const InputEvent &b) {
+    return a.frame < b.frame;
+  });
+  return true;
+}
+
+BatchResult Batch::RunJob(const BatchJob &job) {
+  BatchResult result = {};
+  std::vector<InputEvent> events;
+  std::size_t nextEvent = 0;
+  ScriptedInput input;
+  Chip8 chip8(job.instructionsPerFrame * FRAME_RATE, DEBUG_FALSE);
+  auto start = std::chrono::steady_clock::now();
+
+  chip8.AttachInput(&input);
+  if (job.error) {
+    result.error = job.error;
+    return result;
+  }
+  if (!chip8.LoadROM(job.romPath.c_str())) {
+    result.error = "cannot load rom";
+    return result;
+  }
+  if (!LoadScript(job.scriptPath, events)) {
+    result.error = "bad script";
+    return result;
+  }
+  result.loaded = true;
+
+  // A cycle budget runs whole frames first, then the leftover instructions
+  unsigned long frames = job.budgetInFrames ? job.budget : job.budget / job.instructionsPerFrame;
+  unsigned long remainder = job.budgetInFrames ? 0 : job.budget % job.instructionsPerFrame;
+  for (unsigned long frame = 0; frame <= frames; frame++) {
+    while (nextEvent < events.size() && events[nextEvent].frame <= frame) {
+      input.SetKeys(events[nextEvent++].keys);
+    }
+    if (frame < frames)
+      chip8.RunFrames(1);
+  }
+  chip8.RunCycles(remainder);
+
+  result.frames = frames;
+  result.cycles = chip8.GetCycle();
+  result.displayHash = HashDisplay(chip8.GetDisplay());
+  result.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return result;
+}
+
+void Batch::Run(unsigned threads) {
+  results.assign(jobs.size(), BatchResult{});
+  ThreadPool pool(threads);
+  // Longest jobs first so stragglers don't serialize the tail of the run
+  std::vector<std::size_t> order(jobs.size());
+  for (std::size_t i = 0; i < order.size(); i++) order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+    auto cost = [&](const BatchJob &job) {
+      return job.budgetInFrames ? job.budget * job.instructionsPerFrame : job.budget;
+    };
+    return cost(jobs[a]) > cost(jobs[b]);
+  });
+  for (std::size_t i : order) {
+    pool.Submit([this, i](unsigned) { results[i] = RunJob(jobs[i]); });
+  }
+  pool.Wait();
+}
+
+void Batch::WriteResults(std::ostream &out) {
+  out << "rom,script,frames,cycles,display_hash,wall_ms,error\n";
+  for (std::size_t i = 0; i < jobs.size(); i++) {
+    const BatchJob &job = jobs[i];
+    const BatchResult &result = results[i];
+    out << job.romPath << "," << job.scriptPath << ",";
+    if (!result.loaded) {
+      out << ",,,," << result.error << "\n";
+      continue;
+    }
+    out << result.frames << "," << result.cycles << ","
+        << std::hex << std::setfill('0') << std::setw(16) << result.displayHash << std::dec << ","
+        << std::fixed << std::setprecision(3) << result.wallSeconds * 1000.0 << ",\n";
+  }
+}
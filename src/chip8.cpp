@@ -1,35 +1,27 @@
 #include "chip8.h"
-#include "screen.h"
-#include <GLFW/glfw3.h>
+#include "savestate.h"
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <fstream>
-#include <iomanip>
 #include <iostream>
-#include <memory>
-#include <sstream>
 #include <string>
-#include <time.h>
-#include <utilities.h>
-
-int virtualKeys[] = { 
-  GLFW_KEY_1, // 0
-  GLFW_KEY_2, // 1
-  GLFW_KEY_3, // 2
-  GLFW_KEY_4, // 3
-  GLFW_KEY_Q, // 4
-  GLFW_KEY_W, // 5
-  GLFW_KEY_E, // 6
-  GLFW_KEY_R, // 7
-  GLFW_KEY_A, // 8
-  GLFW_KEY_S, // 9
-  GLFW_KEY_D, // A
-  GLFW_KEY_F, // B
-  GLFW_KEY_Z, // C
-  GLFW_KEY_X, // D
-  GLFW_KEY_C, // E
-  GLFW_KEY_V, // F
-};
+#include <thread>
+
+// Instrumentation hooks around every executed handler; they expand to nothing unless CHIP8_PROFILE is defined
+#if defined(CHIP8_PROFILE_TIMING)
+#define PROFILE_DECLARE() std::uint64_t profileStart = 0;
+#define PROFILE_BEGIN() profile.Visit(pc & (MEMORY - 1)); profileStart = ProfileTimestamp();
+#define PROFILE_END(operation) profile.Sample(operation, ProfileTimestamp() - profileStart);
+#elif defined(CHIP8_PROFILE)
+#define PROFILE_DECLARE()
+#define PROFILE_BEGIN() profile.Visit(pc & (MEMORY - 1));
+#define PROFILE_END(operation) profile.Count(operation);
+#else
+#define PROFILE_DECLARE()
+#define PROFILE_BEGIN()
+#define PROFILE_END(operation)
+#endif
 
 Byte fontset[80] = { 
   0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
@@ -50,12 +42,58 @@ Byte fontset[80] = {
   0xF0, 0x80, 0xF0, 0x80, 0x80  // F
 };
 
-Chip8::Chip8(Byte instructionFrequency, Byte debugFlag) {
-  this->instructionFrequency = instructionFrequency;
+Chip8::Chip8(unsigned long instructionsPerSecond, Byte debugFlag)
+    : rewind(STATE_SIZE, REWIND_SNAPSHOTS, REWIND_KEYFRAME_INTERVAL) {
+  SetInstructionsPerSecond(instructionsPerSecond);
   this->debugFlag = debugFlag;
+  video = nullptr;
+  audio = nullptr;
+  input = nullptr;
+  clock = &wallClock;
+  turbo = false;
+  turboDrawInterval = 1;
+  speedFrames = 0;
+  speedTime = 0;
+  speed = 0;
+  seed = DEFAULT_SEED;
+  romHash = 0;
+  recording = nullptr;
+  dirtyRows = 0;
+  displayGeneration = 0;
+  woken = false;
+  running = false;
+  stepCounter = 0;
+#ifdef CHIP8_JIT
+  jit = std::make_unique<Jit>(this);
+#endif
   Reset();
-  screen = std::make_unique<Screen>("../vertexShader.glsl", "../fragmentShader.glsl", this);
-  buzzer = std::make_unique<Buzzer>();
+}
+
+// Sets the seed used from now on and by every later Reset
+void Chip8::Seed(std::uint64_t seed) {
+  this->seed = seed;
+  random.Seed(seed);
+}
+
+void Chip8::AttachVideo(VideoDevice *video) {
+  this->video = video;
+}
+
+void Chip8::AttachAudio(AudioDevice *audio) {
+  this->audio = audio;
+}
+
+void Chip8::AttachInput(InputDevice *input) {
+  this->input = input;
+}
+
+void Chip8::SetInstructionsPerSecond(unsigned long instructionsPerSecond) {
+  this->instructionsPerSecond = std::clamp<unsigned long>(instructionsPerSecond, 1, MAX_IPS);
+}
+
+// Replaces the wall clock that paces StartMainLoop; nullptr restores it
+void Chip8::AttachClock(Clock *clock) {
+  this->clock = clock ? clock : &wallClock;
 }
 
 void Chip8::Reset() {
@@ -69,489 +107,1084 @@ void Chip8::Reset() {
   elapsedTime = 0;
   deltaTime = 0;
   opcode = 0;
+  keys = 0;
+  cycle = 0;
+  cyclesLeft = 0;
+  idleCycles = 0;
+  waitingForKey = false;
+  framePhase = 0;
   paused = false;
+  rewinding = false;
+  rewind.Clear();
+#ifdef CHIP8_TRACE
+  trace.Clear();
+#endif
+#ifdef CHIP8_PROFILE
+  profile.Clear();
+#endif
 
-  srand(time(NULL));
+  random.Seed(seed);
   std::fill(memory, memory + MEMORY, 0);
+  std::fill(V, V + 16, 0);
   std::fill(stack, stack + 16, 0);
   for (int i = 0; i < 80; i++) {
     memory[i] = fontset[i];
   }
-  std::fill(display, display + (DISPLAY_WIDTH * DISPLAY_HEIGHT), 0);
+  std::fill(display, display + DISPLAY_HEIGHT, 0);
+  MarkDirty(0xFFFFFFFF);
+  InvalidateDecoded(0, MEMORY);
 }
 
 int Chip8::LoadROM(const char *romPath) {
   Byte *buffer;
   std::size_t bufferSize;
+  int loaded;
   std::ifstream rom(romPath, std::ios::binary | std::ios::ate);
 
-  Reset();
-
-  if (!rom.is_open())
+  if (!rom.is_open()) {
+    Reset();
     return 0;
+  }
 
   bufferSize = rom.tellg();
   buffer = new Byte[bufferSize];
 
   rom.seekg(0, rom.beg);
   rom.read(reinterpret_cast<char*>(buffer), bufferSize);
-
-  for (int i = 0; i < bufferSize; i++) {
-    memory[0x200 + i] = buffer[i];
-  }
+  loaded = LoadROM(buffer, bufferSize);
 
   rom.close();
   delete[] buffer;
 
-  return 1; 
+  return loaded;
+}
+
+// Resets and copies a program to 0x200; programs that do not fit are rejected
+int Chip8::LoadROM(const Byte *rom, std::size_t size) {
+  Reset();
+
+  if (size > MEMORY - 0x200)
+    return 0;
+
+  romHash = 14695981039346656037ULL;
+  for (std::size_t i = 0; i < size; i++) {
+    memory[0x200 + i] = rom[i];
+    romHash = (romHash ^ rom[i]) * 1099511628211ULL;
+  }
+  InvalidateDecoded(0x200, size);
+  if (recording) recording->Begin(seed, romHash);
+
+  return 1;
+}
+
+// Writes the machine state to state[0, STATE_SIZE); returns the bytes written, or 0 if size is too small
+std::size_t Chip8::SaveState(Byte *state, std::size_t size) const {
+  Byte *p = state;
+  if (size < STATE_SIZE)
+    return 0;
+
+  std::memcpy(p, STATE_MAGIC, 4); p += 4;
+  StatePut16(p, STATE_VERSION); p += 2;
+  StatePut16(p, STATE_SIZE); p += 2;
+  std::memcpy(p, memory, MEMORY); p += MEMORY;
+  std::memcpy(p, V, 16); p += 16;
+  for (int i = 0; i < 16; i++) *p++ = (keys >> i) & 1;
+  StatePut16(p, I); p += 2;
+  StatePut16(p, pc); p += 2;
+  for (int i = 0; i < 16; i++, p += 2) StatePut16(p, stack[i]);
+  *p++ = sp;
+  *p++ = delayTimer;
+  *p++ = soundTimer;
+  *p++ = static_cast<Byte>(PressedKey());
+  for (int row = 0; row < DISPLAY_HEIGHT; row++, p += 8) StatePut64(p, display[row]);
+  for (int i = 0; i < 4; i++, p += 4) StatePut32(p, random.state[i]);
+  StatePut64(p, cycle); p += 8;
+  *p++ = framePhase;
+  return p - state;
+}
+
+// Restores a state written by SaveState; a malformed state is rejected and leaves the machine untouched
+bool Chip8::LoadState(const Byte *state, std::size_t size) {
+  const Byte *p = state;
+  if (size < STATE_SIZE || std::memcmp(p, STATE_MAGIC, 4) != 0 ||
+      StateGet16(p + 4) != STATE_VERSION || StateGet16(p + 6) != STATE_SIZE)
+    return false;
+  p += 8;
+  // sp == 16 is reachable (16 nested calls); anything above it is not
+  if (p[MEMORY + 16 + 16 + 2 + 2 + 32] > 16 || state[STATE_SIZE - 1] >= FRAME_RATE)
+    return false;
+
+  // Only blocks that differ are copied, so cached decodes elsewhere survive a fork
+  for (int block = 0; block < MEMORY; block += 64) {
+    if (std::memcmp(memory + block, p + block, 64) != 0) {
+      std::memcpy(memory + block, p + block, 64);
+      InvalidateDecoded(block, 64);
+    }
+  }
+  p += MEMORY;
+  std::memcpy(V, p, 16); p += 16;
+  keys = 0;
+  for (int i = 0; i < 16; i++) keys |= (*p++ ? 1 : 0) << i;
+  I = StateGet16(p); p += 2;
+  pc = StateGet16(p); p += 2;
+  for (int i = 0; i < 16; i++, p += 2) stack[i] = StateGet16(p);
+  sp = *p++;
+  delayTimer = *p++;
+  soundTimer = *p++;
+  p++; // Key pressed is derived from the key bytes
+  std::uint32_t rows = 0;
+  for (int row = 0; row < DISPLAY_HEIGHT; row++, p += 8) {
+    std::uint64_t value = StateGet64(p);
+    if (value != display[row]) rows |= 1u << row;
+    display[row] = value;
+  }
+  if (rows) MarkDirty(rows);
+  for (int i = 0; i < 4; i++, p += 4) random.state[i] = StateGet32(p);
+  cycle = StateGet64(p); p += 8;
+  framePhase = *p++;
+  return true;
+}
+
+// FNV-1a over the save state, so two runs can be compared by a single number. The trailing frame
+// phase is left out: it is host scheduling rather than machine state, and a replay, which runs by
+// recorded cycles instead of whole frames, does not reproduce it
+std::uint64_t Chip8::HashState() const {
+  Byte state[STATE_SIZE];
+  std::uint64_t hash = 14695981039346656037ULL;
+  SaveState(state, sizeof(state));
+  for (std::size_t i = 0; i < STATE_SIZE - 1; i++) {
+    hash = (hash ^ state[i]) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+// Records every key change and timer tick into replay from the next LoadROM on
+void Chip8::StartRecording(Replay *replay) {
+  recording = replay;
+}
+
+// Stamps the recording with its length and final state hash
+void Chip8::StopRecording() {
+  if (!recording) return;
+  recording->End(cycle, HashState());
+  recording = nullptr;
 }
 
+// Re-runs a recording headlessly at full speed; false if the ROM is missing or differs from the recorded one
+bool Chip8::PlayReplay(const char *romPath, const Replay &replay) {
+  ScriptedInput replayInput;
+  InputDevice *attachedInput = input;
+  Replay *attachedRecording = recording;
+  bool loaded;
+
+  recording = nullptr;
+  Seed(replay.seed);
+  loaded = LoadROM(romPath) && romHash == replay.romHash;
+  if (loaded) {
+    input = &replayInput;
+    for (const ReplayEvent &event : replay.Events()) {
+      RunCycles(event.cycle - cycle);
+      if (event.keyChange)
+        replayInput.SetKeys(event.keys);
+      else
+        DecrementTimers();
+    }
+    RunCycles(replay.cycles - cycle);
+  }
+  input = attachedInput;
+  recording = attachedRecording;
+  return loaded;
+}
+
+// Runs the core on its own thread and the video device on the calling thread until the window closes,
+// so a slow draw or buffer swap never delays emulation (and a long emulated frame never stalls drawing)
 void Chip8::StartMainLoop() {
+  InputDevice *attachedInput = input;
+  if (!video) return;
+
+  // Input is sampled on this thread and queued to the emulation thread
+  if (!frontend) frontend = std::make_unique<Frontend>();
+  inputQueue.SetSource(attachedInput);
+  input = &inputQueue;
+  PublishSnapshot();
+  running = true;
+  std::thread emulation(&Chip8::EmulationLoop, this);
+
+  while (video->IsOpen()) {
+    video->Draw();
+    if (inputQueue.Poll(clock->Now()))
+      Notify();
+
+    // Paused or blocked in Fx0A (sleep until input instead of redrawing every refresh)
+    const Snapshot &state = GetSnapshot();
+    if (state.paused || (state.waitingForKey && !state.delayTimer && !state.soundTimer))
+      video->WaitEvents(PAUSED_WAIT);
+  }
+
+  running = false;
+  Notify();
+  emulation.join();
+  input = attachedInput;
+}
+
+// Queues a change for the emulation thread and wakes it if it is idle
+bool Chip8::Send(const Command &command) {
+  if (!frontend->commands.Push(command))
+    return false;
+  Notify();
+  return true;
+}
+
+// Window thread: ends the emulation thread's current WaitForWindow early
+void Chip8::Notify() {
+  {
+    std::lock_guard<std::mutex> lock(wakeMutex);
+    woken = true;
+  }
+  wake.notify_one();
+}
+
+// Emulation thread: sleeps until Notify or the timeout, whichever comes first
+void Chip8::WaitForWindow(std::uint64_t timeout) {
+  std::unique_lock<std::mutex> lock(wakeMutex);
+  wake.wait_for(lock, std::chrono::nanoseconds(timeout), [this] { return woken; });
+  woken = false;
+}
+
+void Chip8::EmulationLoop() {
   Byte soundPlaying = 0;
-  while (!glfwWindowShouldClose(screen->window)) {
-    screen->Draw();
+  lastTime = clock->Now();
+  while (running) {
+    ApplyCommands();
 
-    if (paused) continue;
+    // Paused (wait for the window thread instead of spinning)
+    if (paused) {
+      inputQueue.Update();
+      PublishSnapshot();
+      WaitForWindow(PAUSED_WAIT);
+      lastTime = clock->Now();
+      continue;
+    }
 
     UpdateTimers();
 
     // Buzzer Control
-    if (soundTimer > 0 && !soundPlaying) {
-      buzzer->Play();
-      soundPlaying = 1;
+    if (audio) {
+      if (soundTimer > 0 && !soundPlaying) {
+        audio->Play();
+        soundPlaying = 1;
+      }
+      else {
+        audio->Stop();
+        soundPlaying = 0;
+      }
+    }
+
+    if (turbo) {
+      RunTurbo();
+      UpdateSpeed();
+      PublishSnapshot();
     }
     else {
-      buzzer->Stop();
-      soundPlaying = 0;
+      // Fixed Timestep (one frame per 1/60 s of elapsed time, catching up at most MAX_CATCHUP_FRAMES at once)
+      for (int frames = 0; elapsedTime >= NANOSECONDS && frames < MAX_CATCHUP_FRAMES; frames++) {
+        if (rewinding) {
+          inputQueue.Update();
+          RewindFrame();
+        }
+        else {
+          // This frame's share of host time ended (elapsedTime - NANOSECONDS) / FRAME_RATE ago
+          RunLiveFrame(currentTime - (elapsedTime - NANOSECONDS) / FRAME_RATE);
+          RecordFrame();
+        }
+        speedFrames++;
+        elapsedTime -= NANOSECONDS;
+      }
+      // A longer host stall is dropped instead of being replayed as a burst
+      if (elapsedTime >= NANOSECONDS)
+        elapsedTime %= NANOSECONDS;
+      UpdateSpeed();
+      PublishSnapshot();
     }
-    
-    lastTime = glfwGetTime();
-
-    // Display Refresh
-    if (elapsedTime < DISPLAY_FREQUENCY) continue;
-    Tick();
-    soundTimer = soundTimer > 0 ? soundTimer - 1 : 0;
-    delayTimer = delayTimer > 0 ? delayTimer - 1 : 0;
-    elapsedTime = 0;
+
+    // Nothing can change until a key arrives, in turbo as much as in real time
+    if (BlockedOnKey()) {
+      WaitForWindow(PAUSED_WAIT);
+      continue;
+    }
+
+    // Frame Pacing
+    std::uint64_t deadline = turbo ? 0 : currentTime + (NANOSECONDS - elapsedTime) / FRAME_RATE;
+    clock->SleepUntil(deadline);
   }
+  if (audio && soundPlaying)
+    audio->Stop();
 }
 
-void Chip8::UpdateTimers() {
-  currentTime = glfwGetTime();
-  deltaTime = currentTime - lastTime;
-  elapsedTime += deltaTime;
+// Applies everything the window thread queued since the last frame
+void Chip8::ApplyCommands() {
+  Command command;
+  while (frontend->commands.Pop(command)) {
+    switch (command.type) {
+      case COMMAND_TOGGLE_PAUSE:
+        paused = !paused;
+        rewinding = false;
+        break;
+      case COMMAND_STEP:
+        if (paused) Step(command.value);
+        break;
+      case COMMAND_SET_IPS:
+        SetInstructionsPerSecond(command.value);
+        break;
+      case COMMAND_SET_TURBO:
+        turbo = command.value;
+        break;
+      case COMMAND_SET_DRAW_INTERVAL:
+        turboDrawInterval = std::max(command.value, 1UL);
+        break;
+      case COMMAND_SET_REWINDING:
+        rewinding = command.value && !paused;
+        break;
+      case COMMAND_REWIND_FRAME:
+        if (paused) RewindFrame();
+        break;
+      case COMMAND_POKE:
+        memory[command.address & (MEMORY - 1)] = command.value;
+        InvalidateDecoded(command.address & (MEMORY - 1), 1);
+        break;
+      case COMMAND_LOAD_ROM:
+        LoadROM(command.path.c_str());
+        break;
+    }
+  }
 }
 
-void Chip8::Tick() {
-  for (int i = 0; i < instructionFrequency; i++) {
-    UpdateTimers();
+// Single-steps while paused; timers are decremented once every FRAME_RATE instructions
+void Chip8::Step(unsigned long instructions) {
+  // Like RunCycles, only latch (and record) the keypad when an instruction will see it
+  if (instructions == 0)
+    return;
+  ProcessInput();
+  for (unsigned long i = 0; i < instructions; i++) {
+    if (stepCounter % FRAME_RATE == 0)
+      DecrementTimers();
     EmulateCycle();
-    lastTime = glfwGetTime();
+    stepCounter++;
   }
 }
 
-void Chip8::EmulateCycle() {
-  opcode = (memory[pc] << 8) | memory[pc + 1];
+// Copies everything the windows show into the snapshot mailbox
+void Chip8::PublishSnapshot() {
+  Snapshot &snapshot = frontend->snapshots.Back();
+  std::memcpy(snapshot.rows, display, sizeof(snapshot.rows));
+  std::memcpy(snapshot.memory, memory, MEMORY);
+  std::memcpy(snapshot.V, V, sizeof(V));
+  std::memcpy(snapshot.stack, stack, sizeof(stack));
+  snapshot.I = I;
+  snapshot.pc = pc;
+  snapshot.opcode = opcode;
+  snapshot.sp = sp;
+  snapshot.delayTimer = delayTimer;
+  snapshot.soundTimer = soundTimer;
+  snapshot.pressedKey = PressedKey();
+  snapshot.instructionsPerSecond = instructionsPerSecond;
+  snapshot.paused = paused;
+  snapshot.waitingForKey = waitingForKey;
+  snapshot.turbo = turbo;
+  snapshot.turboDrawInterval = turboDrawInterval;
+  snapshot.speed = speed;
+  snapshot.rewindFrames = rewind.Size();
+  snapshot.rewindBytes = rewind.Bytes();
+#ifdef CHIP8_TRACE
+  snapshot.trace = trace;
+#endif
+#ifdef CHIP8_PROFILE
+  snapshot.profile = profile;
+#endif
+  frontend->snapshots.Publish();
+}
+
+// Fast-forward: runs frames back to back until at least turboDrawInterval have run
+// and one display refresh of wall time has passed, then returns to publish a frame
+void Chip8::RunTurbo() {
+  std::uint64_t deadline = currentTime + NANOSECONDS / FRAME_RATE;
+  unsigned long frames = 0;
+  do {
+    inputQueue.Update();
+    if (rewinding && !RewindFrame())
+      break;
+    if (!rewinding)
+      RunFrame();
+    frames++;
+    clock->Advance();
+    // Further frames would only spin in Fx0A; EmulationLoop sleeps until input instead
+    if (BlockedOnKey())
+      break;
+  } while (frames < turboDrawInterval || clock->Now() < deadline);
+  // One snapshot per published frame keeps the rewind ring from being flooded
+  if (!rewinding)
+    RecordFrame();
+  speedFrames += frames;
+  // Leaving turbo resumes real time from here rather than catching up
+  lastTime = clock->Now();
+  elapsedTime = 0;
+}
+
+// Blocked in Fx0A with both timers stopped and no key change queued (one that is already queued
+// for a later frame is picked up at the next deadline instead)
+bool Chip8::BlockedOnKey() const {
+  std::uint64_t keyTime;
+  return waitingForKey && !delayTimer && !soundTimer && !rewinding && !inputQueue.Pending(keyTime);
+}
+
+// Emulated frames per wall second relative to FRAME_RATE, averaged over SPEED_WINDOW
+void Chip8::UpdateSpeed() {
+  std::uint64_t window = currentTime - speedTime;
+  if (window < SPEED_WINDOW)
+    return;
+  speed = float(speedFrames) * NANOSECONDS / (float(window) * FRAME_RATE);
+  speedFrames = 0;
+  speedTime = currentTime;
+}
+
+// Snapshots the machine into the rewind ring at a display refresh
+void Chip8::RecordFrame() {
+  Byte state[STATE_SIZE];
+  SaveState(state, sizeof(state));
+  rewind.Push(state);
+}
+
+// Restores the newest snapshot in the rewind ring; false once history runs out
+bool Chip8::RewindFrame() {
+  Byte state[STATE_SIZE];
+  // Going back in time would break the cycle order of a recording, so it ends here
+  StopRecording();
+  return rewind.Pop(state) && LoadState(state, sizeof(state));
+}
 
-  // Process input before decoding
+// Runs a fixed number of instructions without touching the host clock
+void Chip8::RunCycles(unsigned long cycles) {
+  waitingForKey = false;
+  if (cycles == 0)
+    return;
   ProcessInput();
+  // Profiled builds interpret everything so every instruction is counted, and so does StartMainLoop
+  // (compiled blocks write no trace entries, and the debugger's trace must not have gaps)
+#if defined(CHIP8_JIT) && !defined(CHIP8_PROFILE)
+  if (jit->Available() && !running) {
+    jit->Run(cycles);
+    return;
+  }
+#endif
+  idleCycles = 0;
+#if defined(CHIP8_DISPATCH_THREADED) || defined(CHIP8_DISPATCH_SWITCH)
+  RunThreaded(cycles);
+#else
+  cyclesLeft = cycles;
+  while (cyclesLeft > 0) {
+    cyclesLeft--;
+    EmulateCycle();
+  }
+#endif
+  // A fast-forward always ends the call, so it belongs to the newest trace entry
+#ifdef CHIP8_TRACE
+  if (idleCycles) trace.MarkIdle(idleCycles);
+#endif
+}
 
-  // Decode Instructions
-  (this->*opcodeTable[(opcode & 0xF000) >> 12])();
+// Runs whole 60 Hz frames without touching the host clock
+void Chip8::RunFrames(unsigned long frames) {
+  for (unsigned long i = 0; i < frames; i++) {
+    RunFrame();
+  }
 }
 
-void Chip8::ProcessInput() {
-  keyPressed = -1;
-  for (int i = 0; i < 16; i++) {
-    if (glfwGetKey(screen->window, virtualKeys[i]) == GLFW_PRESS) {
-      key[i] = 1;
-      keyPressed = i;
-    } else {
-      key[i] = 0;
+// One frame: its share of instructionsPerSecond, then one timer decrement
+void Chip8::RunFrame() {
+  RunCycles(FrameCycles());
+  DecrementTimers();
+}
+
+// A frame of the windowed loop that covers host time up to frameEnd: key changes queued by the window
+// thread are applied at the instruction their time falls on, instead of at the next frame boundary
+void Chip8::RunLiveFrame(std::uint64_t frameEnd) {
+  const std::uint64_t length = NANOSECONDS / FRAME_RATE;
+  std::uint64_t frameStart = frameEnd - length;
+  unsigned long cycles = FrameCycles();
+  unsigned long done = 0;
+  bool changed = false;
+  std::uint64_t time;
+  while (inputQueue.Pending(time) && time < frameEnd) {
+    unsigned long at = time <= frameStart ? 0 : (time - frameStart) * cycles / length;
+    // A change right behind another still gets an instruction of its own, so the ROM sees both
+    if (changed && at <= done)
+      at = done + 1;
+    if (at >= cycles && changed)
+      break; // Left queued for the next frame
+    if (at > done) {
+      RunCycles(at - done);
+      done = at;
+    }
+    inputQueue.Update();
+    changed = true;
+  }
+  if (cycles > done)
+    RunCycles(cycles - done);
+  DecrementTimers();
+}
+
+// Instructions in the next frame; every FRAME_RATE frames add up to exactly instructionsPerSecond
+unsigned long Chip8::FrameCycles() {
+  unsigned long long begin = static_cast<unsigned long long>(instructionsPerSecond) * framePhase / FRAME_RATE;
+  unsigned long long end = static_cast<unsigned long long>(instructionsPerSecond) * (framePhase + 1) / FRAME_RATE;
+  framePhase = (framePhase + 1) % FRAME_RATE;
+  return end - begin;
+}
+
+// One clock read per main loop iteration
+void Chip8::UpdateTimers() {
+  currentTime = clock->Now();
+  deltaTime = currentTime - lastTime;
+  elapsedTime += deltaTime * FRAME_RATE;
+  lastTime = currentTime;
+}
+
+void Chip8::DecrementTimers() {
+  if (recording) recording->RecordTick(cycle);
+  soundTimer = soundTimer > 0 ? soundTimer - 1 : 0;
+  delayTimer = delayTimer > 0 ? delayTimer - 1 : 0;
+}
+
+void Chip8::EmulateCycle() {
+  const Instruction &instruction = decoded[pc & (MEMORY - 1)];
+  if (!instruction.execute)
+    Decode(pc & (MEMORY - 1));
+  opcode = instruction.opcode;
+
+#ifdef CHIP8_TRACE
+  Word tracePC = pc;
+#endif
+  PROFILE_DECLARE()
+  PROFILE_BEGIN()
+
+  // Execute Predecoded Instruction
+  (this->*instruction.execute)(instruction);
+  cycle++;
+  PROFILE_END(instruction.operation)
+
+#ifdef CHIP8_TRACE
+  trace.Push(tracePC, pc, opcode, I, V, delayTimer, soundTimer, sp);
+#endif
+}
+
+// Called by the jump at address jump (already taken) when it closes a loop that only waits for the next
+// timer tick: a jump to itself, or a delay timer poll
+//   Fx07 / 3xnn or 4xnn on the same Vx / 1nnn back to the Fx07
+// that keeps looping for the current delay timer value. Timers and input only change between RunCycles
+// calls, so the rest of this call is fast-forwarded, leaving V, pc and cycle exactly where executing it
+// would have.
+void Chip8::SkipIdleLoop(Word jump) {
+  unsigned long skipped = cyclesLeft;
+
+  if (pc != jump) {
+    Word read = (memory[pc & (MEMORY - 1)] << 8) | memory[(pc + 1) & (MEMORY - 1)];
+    Word test = (memory[(pc + 2) & (MEMORY - 1)] << 8) | memory[(pc + 3) & (MEMORY - 1)];
+    Byte x = (read >> 8) & 0xF;
+    Byte nn = test & 0xFF;
+    if ((read & 0xF0FF) != 0xF007 || ((test >> 8) & 0xF) != x)
+      return;
+    if (!((test >> 12 == 0x3 && delayTimer != nn) || (test >> 12 == 0x4 && delayTimer == nn)))
+      return;
+    V[x] = delayTimer;
+    // The skipped instructions run Fx07, the test and the jump in turn, starting at pc
+    FastForward(OP_Fx07, pc, (skipped + 2) / 3);
+    FastForward(test >> 12 == 0x3 ? OP_3xnn : OP_4xnn, pc + 2, (skipped + 1) / 3);
+    FastForward(OP_1nnn, jump, skipped / 3);
+    pc += 2 * (skipped % 3);
+  }
+  else {
+    FastForward(OP_1nnn, jump, skipped);
+  }
+  cycle += skipped;
+  cyclesLeft = 0;
+}
+
+// Accounts for instructions skipped instead of executed, so the profile and trace still show them
+void Chip8::FastForward([[maybe_unused]] int operation, [[maybe_unused]] Word address, unsigned long times) {
+#ifdef CHIP8_PROFILE
+  profile.FastForward(operation, address & (MEMORY - 1), times);
+#endif
+  idleCycles += times;
+}
+
+// Same per-instruction work as EmulateCycle, but dispatched on the predecoded
+// operation id instead of calling through a pointer-to-member per instruction
+void Chip8::RunThreaded(unsigned long cycles) {
+  const Instruction *instruction;
+#ifdef CHIP8_TRACE
+  Word tracePC;
+#endif
+  PROFILE_DECLARE()
+
+#define FETCH()                                     \
+  instruction = &decoded[pc & (MEMORY - 1)];        \
+  if (!instruction->execute)                        \
+    Decode(pc & (MEMORY - 1));                      \
+  opcode = instruction->opcode;                     \
+  PROFILE_BEGIN()
+
+#ifdef CHIP8_TRACE
+#define TRACE_BEGIN() tracePC = pc;
+#define TRACE_END() trace.Push(tracePC, pc, opcode, I, V, delayTimer, soundTimer, sp);
+#else
+#define TRACE_BEGIN()
+#define TRACE_END()
+#endif
+
+#ifdef CHIP8_DISPATCH_THREADED
+#define CHIP8_OPERATION_LABEL(name) &&label##name,
+  static void *const dispatchTable[OP_COUNT] = { CHIP8_OPERATIONS(CHIP8_OPERATION_LABEL) };
+#undef CHIP8_OPERATION_LABEL
+
+  // Each handler ends in its own indirect jump to the next one
+#define CHIP8_OPERATION_BODY(name)                  \
+  label##name:                                      \
+    op##name(*instruction);                         \
+    cycle++;                                        \
+    PROFILE_END(OP_##name)                          \
+    TRACE_END()                                     \
+    if (cyclesLeft == 0)                            \
+      return;                                       \
+    cyclesLeft--;                                   \
+    FETCH()                                         \
+    TRACE_BEGIN()                                   \
+    goto *dispatchTable[instruction->operation];
+
+  cyclesLeft = cycles - 1;
+  FETCH()
+  TRACE_BEGIN()
+  goto *dispatchTable[instruction->operation];
+  CHIP8_OPERATIONS(CHIP8_OPERATION_BODY)
+#undef CHIP8_OPERATION_BODY
+#else
+#define CHIP8_OPERATION_CASE(name)                  \
+    case OP_##name:                                 \
+      op##name(*instruction);                       \
+      cycle++;                                      \
+      PROFILE_END(OP_##name)                        \
+      break;
+
+  cyclesLeft = cycles;
+  while (cyclesLeft > 0) {
+    cyclesLeft--;
+    FETCH()
+    TRACE_BEGIN()
+    switch (instruction->operation) {
+      CHIP8_OPERATIONS(CHIP8_OPERATION_CASE)
     }
+    TRACE_END()
   }
+#undef CHIP8_OPERATION_CASE
+#endif
+
+#undef FETCH
+#undef TRACE_BEGIN
+#undef TRACE_END
+}
+
+// Latches the keypad for the instructions of one RunCycles call
+void Chip8::ProcessInput() {
+  keys = input ? input->Keys() : 0;
+  if (recording) recording->RecordKeys(cycle, keys);
 }
 
-void Chip8::op0xxx() {
-  std::stringstream entry;
-  switch (opcode) {
-    // 0x00E0 - Clear Screen
-    case 0x00E0:
-      entry << "0x00E0 CLS           |\tClearing Screen";
-      std::fill(display, display + (DISPLAY_WIDTH * DISPLAY_HEIGHT), 0);
-      pc += 2;
+#define CHIP8_OPERATION_HANDLER(name) &Chip8::op##name,
+void (Chip8::*const Chip8::operationTable[OP_COUNT])(const Instruction &) = {
+  CHIP8_OPERATIONS(CHIP8_OPERATION_HANDLER)
+};
+#undef CHIP8_OPERATION_HANDLER
+
+// Splits an opcode into its operands and resolves the handler that executes it
+void Chip8::Decode(Word address) {
+  Instruction &instruction = decoded[address];
+  Word op = (memory[address] << 8) | memory[(address + 1) & (MEMORY - 1)];
+  instruction.opcode = op;
+  instruction.nnn = op & 0x0FFF;
+  instruction.x = (op & 0x0F00) >> 8;
+  instruction.y = (op & 0x00F0) >> 4;
+  instruction.n = op & 0x000F;
+  instruction.nn = op & 0x00FF;
+  instruction.operation = OP_Unknown;
+  switch (op & 0xF000) {
+    case 0x0000:
+      if (op == 0x00E0) instruction.operation = OP_00E0;
+      if (op == 0x00EE) instruction.operation = OP_00EE;
       break;
-    // 0x00EE - Return
-    case 0x00EE:
-      entry << "0x00EE RET           |\t";
-      if (sp <= 0) {
-        entry << "Stack Underflow! SP = " << int(sp);
-        break;
+    case 0x1000: instruction.operation = OP_1nnn; break;
+    case 0x2000: instruction.operation = OP_2nnn; break;
+    case 0x3000: instruction.operation = OP_3xnn; break;
+    case 0x4000: instruction.operation = OP_4xnn; break;
+    case 0x5000: instruction.operation = OP_5xy0; break;
+    case 0x6000: instruction.operation = OP_6xnn; break;
+    case 0x7000: instruction.operation = OP_7xnn; break;
+    case 0x8000:
+      switch (instruction.n) {
+        case 0x0: instruction.operation = OP_8xy0; break;
+        case 0x1: instruction.operation = OP_8xy1; break;
+        case 0x2: instruction.operation = OP_8xy2; break;
+        case 0x3: instruction.operation = OP_8xy3; break;
+        case 0x4: instruction.operation = OP_8xy4; break;
+        case 0x5: instruction.operation = OP_8xy5; break;
+        case 0x6: instruction.operation = OP_8xy6; break;
+        case 0x7: instruction.operation = OP_8xy7; break;
+        case 0xE: instruction.operation = OP_8xyE; break;
+      }
+      break;
+    case 0x9000: instruction.operation = OP_9xy0; break;
+    case 0xA000: instruction.operation = OP_Annn; break;
+    case 0xB000: instruction.operation = OP_Bnnn; break;
+    case 0xC000: instruction.operation = OP_Cxnn; break;
+    case 0xD000: instruction.operation = OP_Dxyn; break;
+    case 0xE000:
+      if (instruction.nn == 0x9E) instruction.operation = OP_Ex9E;
+      if (instruction.nn == 0xA1) instruction.operation = OP_ExA1;
+      break;
+    case 0xF000:
+      switch (instruction.nn) {
+        case 0x07: instruction.operation = OP_Fx07; break;
+        case 0x0A: instruction.operation = OP_Fx0A; break;
+        case 0x15: instruction.operation = OP_Fx15; break;
+        case 0x18: instruction.operation = OP_Fx18; break;
+        case 0x1E: instruction.operation = OP_Fx1E; break;
+        case 0x29: instruction.operation = OP_Fx29; break;
+        case 0x33: instruction.operation = OP_Fx33; break;
+        case 0x55: instruction.operation = OP_Fx55; break;
+        case 0x65: instruction.operation = OP_Fx65; break;
       }
-      stack[sp] = 0;
-      pc = stack[--sp] + 2;
-      entry << "Returning to " << Utilities::FormatHex(3, pc);
       break;
   }
-  screen->PushToLog(entry.str());
+  instruction.execute = operationTable[instruction.operation];
+}
+
+// Drops cached decodes overlapping memory[address, address + length) so they are re-read from memory
+void Chip8::InvalidateDecoded(Word address, Word length) {
+  // The instruction starting one byte earlier also covers address
+  Word start = address > 0 ? address - 1 : 0;
+  Word end = std::min<unsigned>(address + length, MEMORY);
+  for (Word i = start; i < end; i++) {
+    decoded[i].execute = nullptr;
+  }
+#ifdef CHIP8_JIT
+  if (jit) jit->Invalidate(address, length);
+#endif
+}
+
+// Records changed display rows for the video device
+void Chip8::MarkDirty(std::uint32_t rows) {
+  dirtyRows |= rows;
+  displayGeneration++;
+}
+
+// Returns the rows changed since the previous call and clears them
+std::uint32_t Chip8::TakeDirtyRows() {
+  std::uint32_t rows = dirtyRows;
+  dirtyRows = 0;
+  return rows;
+}
+
+// 0x00E0 - Clear Screen
+void Chip8::op00E0(const Instruction &instruction) {
+  std::uint32_t rows = 0;
+  for (int y = 0; y < DISPLAY_HEIGHT; y++) {
+    if (display[y]) rows |= 1u << y;
+    display[y] = 0;
+  }
+  if (rows) MarkDirty(rows);
+  pc += 2;
+}
+
+// 0x00EE - Return
+void Chip8::op00EE(const Instruction &instruction) {
+  if (sp <= 0)
+    return;
+  pc = stack[--sp] + 2;
+  stack[sp] = 0;
 }
 
 // 0x1nnn - Jump to address nnn
-void Chip8::op1xxx() {
-  std::stringstream entry;
-  pc = opcode & 0x0FFF;
-  entry << Utilities::FormatHex(4, opcode) << " JP nnn        |\tSetting PC to: " << Utilities::FormatHex(3, pc);
-  screen->PushToLog(entry.str());
+void Chip8::op1nnn(const Instruction &instruction) {
+  Word jump = pc;
+  pc = instruction.nnn;
+  if (cyclesLeft > 0 && (instruction.nnn == jump || instruction.nnn + 4 == jump))
+    SkipIdleLoop(jump);
 }
 
 // 0x2nnn - Call function at nnn
-void Chip8::op2xxx() {
-  std::stringstream entry;
-  entry << Utilities::FormatHex(4, opcode) << " CALL nnn      |\t";
+void Chip8::op2nnn(const Instruction &instruction) {
   if (sp >= 16) {
-    entry << "Stack Overflow! SP = " << int(sp);
     pc += 2;
     return;
   }
   stack[sp++] = pc;
-  pc = opcode & 0x0FFF;
-  entry << "Calling function at: " << Utilities::FormatHex(3, pc);
-  screen->PushToLog(entry.str());
+  pc = instruction.nnn;
 }
 
 // 0x3xbb - Skip next instruction if V[x] == bb
-void Chip8::op3xxx() {
-  std::stringstream entry;
-  Byte x = (opcode & 0x0F00) >> 8;
-  entry << Utilities::FormatHex(4, opcode) << " SE Vx, bb     |\t";
-  if (V[x] == (opcode & 0x00FF)) {
+void Chip8::op3xnn(const Instruction &instruction) {
+  if (V[instruction.x] == instruction.nn)
     pc += 2;
-    entry << "Equal, Skipping";
-  } else {
-    entry << "Not Equal, Not Skipping";
-  }
   pc += 2;
-  screen->PushToLog(entry.str());
 }
 
 // 0x4xbb - Skip next instruction if V[x] != bb
-void Chip8::op4xxx() {
-  std::stringstream entry;
-  Byte x = (opcode & 0x0F00) >> 8;
-  entry << Utilities::FormatHex(4, opcode) << " SNE Vx, bb    |\t";
-  if (V[x] != (opcode & 0x00FF)) {
+void Chip8::op4xnn(const Instruction &instruction) {
+  if (V[instruction.x] != instruction.nn)
     pc += 2;
-    entry << "Not Equal, Skipping";
-  } else {
-    entry << "Equal, Not Skipping";
-  }
   pc += 2;
-  screen->PushToLog(entry.str());
 }
 
 // 0x5xy0 - Skip next instruction if V[x] == V[y]
-void Chip8::op5xxx() {
-  std::stringstream entry;
-  Byte x = (opcode & 0x0F00) >> 8;
-  Byte y = (opcode & 0x00F0) >> 4;
-  entry << Utilities::FormatHex(4, opcode) << " SE Vx, Vy     |\t";
-  if (V[x] == V[y]) {
+void Chip8::op5xy0(const Instruction &instruction) {
+  if (V[instruction.x] == V[instruction.y])
     pc += 2;
-    entry << "Equal, Skipping";
-  } else {
-    entry << "Not Equal, Not Skipping";
-  }
   pc += 2;
-  screen->PushToLog(entry.str());
 }
 
 // 0x6xbb - Load bb into V[x]
-void Chip8::op6xxx() {
-  std::stringstream entry;
-  Byte x = (opcode & 0x0F00) >> 8;
-  V[x] = opcode & 0x00FF;
-  entry << Utilities::FormatHex(4, opcode) << " LD Vx, bb     |\tLoaded " << int(V[x]) << " into V[" << Utilities::FormatHex(1, int(x)) << "]"; 
+void Chip8::op6xnn(const Instruction &instruction) {
+  V[instruction.x] = instruction.nn;
   pc += 2;
-  screen->PushToLog(entry.str());
 }
 
 // 0x7xbb - Increment V[x] by bb
-void Chip8::op7xxx() {
-  std::stringstream entry;
-  Byte x = (opcode & 0x0F00) >> 8;
-  entry << Utilities::FormatHex(4, opcode) << " ADD Vx, bb    |\tIncrementing V[" << Utilities::FormatHex(1, int(x)) << "] by " << (opcode & 0x00FF); 
-  V[x] += opcode & 0x00FF;
+void Chip8::op7xnn(const Instruction &instruction) {
+  V[instruction.x] += instruction.nn;
+  pc += 2;
+}
+
+// 0x8xy0 - Load V[y] into V[x]
+void Chip8::op8xy0(const Instruction &instruction) {
+  V[instruction.x] = V[instruction.y];
+  pc += 2;
+}
+
+// 0x8xy1 - Set V[x] = V[x] OR V[y]
+void Chip8::op8xy1(const Instruction &instruction) {
+  V[instruction.x] |= V[instruction.y];
+  pc += 2;
+}
+
+// 0x8xy2 - Set V[x] = V[x] AND V[y]
+void Chip8::op8xy2(const Instruction &instruction) {
+  V[instruction.x] &= V[instruction.y];
+  pc += 2;
+}
+
+// 0x8xy3 - Set V[x] = V[x] XOR V[y]
+void Chip8::op8xy3(const Instruction &instruction) {
+  V[instruction.x] ^= V[instruction.y];
+  pc += 2;
+}
+
+// 0x8xy4 - Increment V[x] by V[y]
+void Chip8::op8xy4(const Instruction &instruction) {
+  Byte x = instruction.x;
+  Word sum = V[x] + V[instruction.y];
+  V[x] = sum & 0xFF;
+  if (sum > 0xFF)
+    V[0xF] = 1;
+  else
+    V[0xF] = 0;
+  pc += 2;
+}
+
+// 0x8xy5 - Decrement V[x] by V[y]
+void Chip8::op8xy5(const Instruction &instruction) {
+  Byte x = instruction.x;
+  Byte y = instruction.y;
+  if (V[x] > V[y]) 
+    V[0xF] = 1;
+  else
+    V[0xF] = 0;
+  V[x] = V[x] - V[y];
+  pc += 2;
+}
+
+// 0x8xy6 - Shift right V[x] by 1 bit
+void Chip8::op8xy6(const Instruction &instruction) {
+  Byte x = instruction.x;
+  V[x] = V[x] >> 1;
+  if ((V[x] & 0x01) == 0x01)
+    V[0xF] = 1;
+  else
+    V[0xF] = 0;
+  pc += 2;
+}
+
+// 0x8xy7 - Set V[x] = V[y] - V[x]
+void Chip8::op8xy7(const Instruction &instruction) {
+  Byte x = instruction.x;
+  Byte y = instruction.y;
+  V[x] = V[y] - V[x];
+  if (V[y] > V[x])
+    V[0xF] = 1;
+  else
+    V[0xF] = 0;
+  pc += 2;
+}
+
+// 0x8xyE - Shift left V[x] by 1 bit
+void Chip8::op8xyE(const Instruction &instruction) {
+  Byte x = instruction.x;
+  V[x] = V[x] << 1;
+  if ((V[x] & 0x80) == 0x80) 
+    V[0xF] = 1;
+  else
+    V[0xF] = 0;
   pc += 2;
-  screen->PushToLog(entry.str());
-}
-
-void Chip8::op8xxx() {
-  std::stringstream entry;
-  Byte x = (opcode & 0x0F00) >> 8;
-  Byte y = (opcode & 0x00F0) >> 4;
-  std::string xString = Utilities::FormatHex(1, int(x));
-  std::string yString = Utilities::FormatHex(1, int(y));
-  std::string opString = Utilities::FormatHex(4, opcode);
-  switch (opcode & 0x000F) {
-    // 0x8xy0 - Load V[y] into V[x]
-    case 0x0000:
-      V[x] = V[y];
-      entry << opString << " LD Vx, Vy     |\tLoading " << int(V[x]) << " into V[" << xString << "]"; 
-      pc += 2;
-      break;
-    // 0x8xy1 - Set V[x] = V[x] OR V[y]
-    case 0x0001:
-      V[x] |= V[y];
-      entry << opString << " OR Vx, Vy     |\tORing V[" << xString << "] and V[" << yString << "] = " << int(V[x]); 
-      pc += 2;
-      break;
-    // 0x8xy2 - Set V[x] = V[x] AND V[y]
-    case 0x0002:
-      V[x] &= V[y];
-      entry << opString << " AND Vx, Vy    |\tANDing V[" << xString << "] and V[" << yString << "] = " << int(V[x]); 
-      pc += 2;
-      break;
-    // 0x8xy3 - Set V[x] = V[x] XOR V[y]
-    case 0x0003:
-      V[x] ^= V[y];
-      entry << opString << " XOR Vx, Vy    |\tXORing V[" << xString << "] and V[" << yString << "] = " << int(V[x]); 
-      pc += 2;
-      break;
-    // 0x8xy4 - Increment V[x] by V[y]
-    case 0x0004: {
-      Word sum = V[x] + V[y];
-      V[x] = sum & 0xFF;
-      if (sum > 0xFF)
-        V[0xF] = 1;
-      else
-        V[0xF] = 0;
-      entry << opString << " ADD Vx, Vy    |\tV[" << xString << "] + V[" << yString << "] = " << int(V[x]) << "; V[0xF] = " << int(V[0xF]); 
-      pc += 2;
-      break;
-    }
-    // 0x8xy5 - Decrement V[x] by V[y]
-    case 0x0005:
-      if (V[x] > V[y]) 
-        V[0xF] = 1;
-      else
-        V[0xF] = 0;
-      V[x] = V[x] - V[y];
-      entry << opString << " SUB Vx, Vy    |\tV[" << xString << "] - V[" << yString << "] = " << int(V[x]) << "; V[0xF] = " << int(V[0xF]); 
-      pc += 2;
-      break;
-    // 0x8xy6 - Shift right V[x] by 1 bit
-    case 0x0006:
-      V[x] = V[x] >> 1;
-      if ((V[x] & 0x01) == 0x01)
-        V[0xF] = 1;
-      else
-        V[0xF] = 0;
-      entry << opString << " SHR Vx        |\tV[" << xString << "] >> 1 = " << int(V[x]) << "; V[0xF] = " << int(V[0xF]); 
-      pc += 2;
-      break;
-    // 0x8xy7 - Set V[x] = V[y] - V[x]
-    case 0x0007:
-      V[x] = V[y] - V[x];
-      if (V[y] > V[x])
-        V[0xF] = 1;
-      else
-        V[0xF] = 0;
-      entry << opString << " SUBN Vx, Vy   |\tV[" << yString << "] - V[" << xString << "] = " << int(V[x]) << "; V[0xF] = " << int(V[0xF]); 
-      pc += 2;
-      break;
-    // 0x8xyE - Shift left V[x] by 1 bit
-    case 0x000E:
-      V[x] = V[x] << 1;
-      if ((V[x] & 0x80) == 0x80) 
-        V[0xF] = 1;
-      else
-        V[0xF] = 0;
-      entry << opString << " SHL Vx        |\tV[" << xString << "] << 1 = " << int(V[x]) << "; V[0xF] = " << int(V[0xF]); 
-      pc += 2;
-      break;
-  }
-  screen->PushToLog(entry.str());
 }
 
 // 0x9xy0 - Skip next instruction if V[x] != V[y]
-void Chip8::op9xxx() {
-  std::stringstream entry;
-  Byte x = (opcode & 0x0F00) >> 8;
-  Byte y = (opcode & 0x00F0) >> 4;
-  entry << Utilities::FormatHex(4, opcode) << " SNE Vx, Vy    |\t";
-  if (V[x] != V[y]) {
+void Chip8::op9xy0(const Instruction &instruction) {
+  if (V[instruction.x] != V[instruction.y])
     pc += 2;
-    entry << "Not Equal, Skipping";
-  } else {
-    entry << "Equal, Not Skipping";
-  }
   pc += 2;
-  screen->PushToLog(entry.str());
 }
 
 // 0xAnnn - Load nnn into I
-void Chip8::opAxxx() {
-  std::stringstream entry;
-  I = opcode & 0x0FFF;
-  entry << Utilities::FormatHex(4, opcode) << " LD I, nnn     |\tLoaded " << Utilities::FormatHex(3, I) << " into I";
+void Chip8::opAnnn(const Instruction &instruction) {
+  I = instruction.nnn;
   pc += 2;
-  screen->PushToLog(entry.str());
 }
 
 // 0xBnnn - Jump to address nnn + V[0]
-void Chip8::opBxxx() {
-  std::stringstream entry;
-  pc = V[0] + opcode & 0x0FFF;
-  entry << Utilities::FormatHex(4, opcode) << " JP V0, addr   |\tSet PC to: " << Utilities::FormatHex(3, pc);
-  screen->PushToLog(entry.str());
-}
-
-// 0xCxbb - Set V[x] = rand(0, 255) AND bb
-void Chip8::opCxxx() {
-  std::stringstream entry;
-  Byte x = (opcode & 0x0F00) >> 8;
-  std::string xString = Utilities::FormatHex(1, int(x));
-  V[x] = (rand() % 256) & (opcode & 0x00FF);
-  entry << Utilities::FormatHex(4, opcode) << " RND Vx, bb    |\tSetting V[" << xString << "] to " << int(V[x]);
+void Chip8::opBnnn(const Instruction &instruction) {
+  pc = V[0] + instruction.opcode & 0x0FFF;
+}
+
+// 0xCxbb - Set V[x] = random(0, 255) AND bb
+void Chip8::opCxnn(const Instruction &instruction) {
+  V[instruction.x] = (random.Next() >> 24) & instruction.nn;
   pc += 2;
-  screen->PushToLog(entry.str());
 }
 
 // 0xDxyn - Draw a sprite of n-bytes high at (V[x], V[y])
-void Chip8::opDxxx() {
-  Byte spriteRow;
-  Byte x = V[(opcode & 0x0F00) >> 8] % DISPLAY_WIDTH;
-  Byte y = V[(opcode & 0x00F0) >> 4] % DISPLAY_HEIGHT;
-  Byte height = opcode & 0x000F;
-  std::stringstream entry;
-  V[0xF] = 0;
+void Chip8::opDxyn(const Instruction &instruction) {
+  Byte x = V[instruction.x] % DISPLAY_WIDTH;
+  Byte y = V[instruction.y] % DISPLAY_HEIGHT;
+  Byte height = instruction.n;
+  std::uint64_t collision = 0;
+  std::uint32_t rows = 0;
   for (int i = 0; i < height; i++) {
     if (y + i >= DISPLAY_HEIGHT) break;
     if (I + i >= MEMORY) break;
-    spriteRow = memory[I + i];
-    for (int j = 0; j < 8; j++) {
-      if (x + j >= DISPLAY_WIDTH) break;
-      Byte pixel = (spriteRow & (0x80 >> j)) > 0 ? 1 : 0;
-      if (!pixel) continue;
-      unsigned index = x + j + ((y + i) * DISPLAY_WIDTH);
-      if (display[index] > 0)
-        V[0xF] = 1;
-      display[index] ^= pixel;
-    }
+    // Bits shifted past column 63 fall off, which clips the sprite at the right edge
+    std::uint64_t spriteRow = static_cast<std::uint64_t>(memory[I + i]) << (DISPLAY_WIDTH - 8) >> x;
+    collision |= display[y + i] & spriteRow;
+    display[y + i] ^= spriteRow;
+    if (spriteRow) rows |= 1u << (y + i);
   }
-  entry << Utilities::FormatHex(4, opcode) << " DRW Vx, Vy, n |\tDrawing at (" << int(V[x]) << ", " << int(V[y]) << "), height = " << int(height) << "; V[0xF] = " << int(V[0xF]);
+  if (rows) MarkDirty(rows);
+  V[0xF] = collision != 0;
   pc += 2;
-  screen->PushToLog(entry.str());
-}
-
-void Chip8::opExxx() {
-  std::stringstream entry;
-  Byte x = (opcode & 0x0F00) >> 8;
-  Byte y = (opcode & 0x00F0) >> 4;
-  switch (opcode & 0x00FF) {
-    // 0xEx9E - Skip next instruction if the key value of V[x] is pressed
-    case 0x009E:
-      entry << Utilities::FormatHex(4, opcode) << " SKP Vx        |\t" << Utilities::FormatHex(1, int(V[x])) << " pressed? ";
-      if (key[V[x]]) {
-        pc += 2;
-        entry << "Yes, skipping";
-      } else {
-        entry << "No, not skipping";
-      }
-      pc += 2;
-      break;
-    // 0xExA1 - Skip next instruction if the key value of V[x] is NOT pressed
-    case 0x00A1:
-      entry << Utilities::FormatHex(4, opcode) << " SKNP Vx       |\t" << Utilities::FormatHex(1, int(V[x])) << " pressed? ";
-      if (!key[V[x]]) {
-        pc += 2;
-        entry << "No, skipping";
-      } else {
-        entry << "Yes, not skipping";
-      }
-      pc += 2;
-      break;
+}
+
+// 0xEx9E - Skip next instruction if the key value of V[x] is pressed
+void Chip8::opEx9E(const Instruction &instruction) {
+  if ((keys >> (V[instruction.x] & 0xF)) & 1)
+    pc += 2;
+  pc += 2;
+}
+
+// 0xExA1 - Skip next instruction if the key value of V[x] is NOT pressed
+void Chip8::opExA1(const Instruction &instruction) {
+  if (!((keys >> (V[instruction.x] & 0xF)) & 1))
+    pc += 2;
+  pc += 2;
+}
+
+// 0xFx07 - Set V[x] = delayTimer
+void Chip8::opFx07(const Instruction &instruction) {
+  V[instruction.x] = delayTimer;
+  pc += 2;
+}
+
+// 0xFx0A - Wait for input and store the key value in V[x]
+void Chip8::opFx0A(const Instruction &instruction) {
+  // The keypad is latched once per RunCycles call, so the rest of this one would keep waiting
+  int key = PressedKey();
+  if (key < 0) {
+    FastForward(OP_Fx0A, pc, cyclesLeft);
+    cycle += cyclesLeft;
+    cyclesLeft = 0;
+    waitingForKey = true;
+    return;
   }
-  screen->PushToLog(entry.str());
-}
-
-void Chip8::opFxxx() {
-  std::stringstream entry;
-  Byte x = (opcode & 0x0F00) >> 8;
-  Byte y = (opcode & 0x00F0) >> 4;
-  switch (opcode & 0x00FF) {
-    // 0xFx07 - Set V[x] = delayTimer
-    case 0x0007:
-      V[x] = delayTimer;
-      pc += 2;
-      entry << Utilities::FormatHex(4, opcode) << " LD Vx, DT     |\tSetting V[" << Utilities::FormatHex(1, int(x)) << "] = " << int(delayTimer);
-      break;
-    // 0xFx0A - Wait for input and store the key value in V[x]
-    case 0x000A:
-      entry << Utilities::FormatHex(4, opcode) << " LD Vx, K      |\tWating for input... ";
-      if (keyPressed < 0) 
-        break;
-      V[x] = keyPressed;
-      entry << "Key " << Utilities::FormatHex(1, V[x]) << " pressed";
-      pc += 2;
-      break;
-    // 0xFx15 - Set delayTimer = V[x]
-    case 0x0015:
-      delayTimer = V[x];
-      pc += 2;
-      entry << Utilities::FormatHex(4, opcode) << " LD DT, Vx     |\tSetting Delay Timer = " << int(V[x]);
-      break;
-    // 0xFx18 - Set soundTimer = V[x]
-    case 0x0018:
-      soundTimer = V[x];
-      pc += 2;
-      entry << Utilities::FormatHex(4, opcode) << " LD ST, Vx     |\tSetting Sound Timer = " << int(V[x]);
-      break;
-    // 0xFx1E - Set I = I + V[x]
-    case 0x001E:
-      I += V[x];
-      pc += 2;
-      entry << Utilities::FormatHex(4, opcode) << " ADD I, Vx     |\tI + V[" << Utilities::FormatHex(1, int(x)) << "] = " << Utilities::FormatHex(3, I);
-      break;
-    // 0xFx29 - Set I equal to the memory address of the font-sprite for the value in V[x]
-    case 0x0029:
-      I = V[x] * 5;
-      pc += 2;
-      entry << Utilities::FormatHex(4, opcode) << " LD F, Vx      |\t";
-      break;
-    // 0xFx33 - Store BCD representation of V[x] at memory locations I, I + 1, I + 2
-    case 0x0033:
-      memory[I] = V[x] / 100;
-      memory[I + 1] = (V[x] % 100) / 10;
-      memory[I + 2] = V[x] % 10;
-      entry << Utilities::FormatHex(4, opcode) << " LD B, Vx      |\t";
-      entry << "memory[" << Utilities::FormatHex(3, I) << "] = "     << int(memory[I])     << "; ";
-      entry << "memory[" << Utilities::FormatHex(3, I + 1) << "] = " << int(memory[I + 1]) << "; ";
-      entry << "memory[" << Utilities::FormatHex(3, I + 2) << "] = " << int(memory[I + 2]) << "; ";
-      pc += 2;
-      break;
-    // 0xFx55 - Store values from registers V[0] to V[x] into memory[I] onwards
-    case 0x0055:
-      entry << Utilities::FormatHex(4, opcode) << " LD [I], Vx    |\t";
-      for (int i = 0; i <= x && I + i < MEMORY; i++) {
-        memory[I + i] = V[i]; 
-        entry << "memory[" << Utilities::FormatHex(3, I + i) << "] = " << int(V[i]) << "; ";
-      }
-      pc += 2;
-      break;
-    // 0xFx65 - Store values starting from memory[I] into registers V[0] to V[x]
-    case 0x0065:
-      entry << Utilities::FormatHex(4, opcode) << " LD Vx, [I]    |\t";
-      for (int i = 0; i <= x && I + i < MEMORY; i++) {
-        V[i] = memory[I + i]; 
-        entry << "V[" << Utilities::FormatHex(1, i) << "] = " << int(V[i]) << "; ";
-      }
-      pc += 2;
-      break;
+  V[instruction.x] = key;
+  pc += 2;
+}
+
+// 0xFx15 - Set delayTimer = V[x]
+void Chip8::opFx15(const Instruction &instruction) {
+  delayTimer = V[instruction.x];
+  pc += 2;
+}
+
+// 0xFx18 - Set soundTimer = V[x]
+void Chip8::opFx18(const Instruction &instruction) {
+  soundTimer = V[instruction.x];
+  pc += 2;
+}
+
+// 0xFx1E - Set I = I + V[x]
+void Chip8::opFx1E(const Instruction &instruction) {
+  I += V[instruction.x];
+  pc += 2;
+}
+
+// 0xFx29 - Set I equal to the memory address of the font-sprite for the value in V[x]
+void Chip8::opFx29(const Instruction &instruction) {
+  I = V[instruction.x] * 5;
+  pc += 2;
+}
+
+// 0xFx33 - Store BCD representation of V[x] at memory locations I, I + 1, I + 2
+void Chip8::opFx33(const Instruction &instruction) {
+  Byte x = instruction.x;
+  memory[I] = V[x] / 100;
+  memory[I + 1] = (V[x] % 100) / 10;
+  memory[I + 2] = V[x] % 10;
+  InvalidateDecoded(I, 3);
+  pc += 2;
+}
+
+// 0xFx55 - Store values from registers V[0] to V[x] into memory[I] onwards
+void Chip8::opFx55(const Instruction &instruction) {
+  for (int i = 0; i <= instruction.x && I + i < MEMORY; i++) {
+    memory[I + i] = V[i]; 
   }
-  screen->PushToLog(entry.str());
+  InvalidateDecoded(I, instruction.x + 1);
+  pc += 2;
+}
+
+// 0xFx65 - Store values starting from memory[I] into registers V[0] to V[x]
+void Chip8::opFx65(const Instruction &instruction) {
+  for (int i = 0; i <= instruction.x && I + i < MEMORY; i++) {
+    V[i] = memory[I + i]; 
+  }
+  pc += 2;
+}
+
+// Unassigned opcodes leave the PC where it is
+void Chip8::opUnknown(const Instruction &instruction) {
 }
 
 Chip8::~Chip8() {
-  std::cout << "Destroying Chip8\n";
+}
+
+// Writes the opcode statistics collected since the last Reset (nothing unless built with CHIP8_PROFILE)
+void Chip8::DumpProfile(std::FILE *out) const {
+#ifdef CHIP8_PROFILE
+  profile.Dump(out);
+#endif
 }
@@ -0,0 +1,258 @@
+#include "jit.h"
+#include "chip8.h"
+#include <algorithm>
+#include <iostream>
+#include <sys/mman.h>
+
+Jit::Jit(Chip8 *chip8) {
+  this->chip8 = chip8;
+  codeSize = 0;
+  std::fill(blocks, blocks + MEMORY, nullptr);
+  void *cache = mmap(nullptr, JIT_CODE_CACHE_SIZE, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  codeCache = cache == MAP_FAILED ? nullptr : static_cast<unsigned char *>(cache);
+  if (!codeCache)
+    std::cerr << "JIT code cache unavailable, falling back to the interpreter\n";
+}
+
+void Jit::Run(unsigned long cycles) {
+  while (cycles > 0) {
+    Word pc = chip8->pc;
+    if (!codeCache || pc >= MEMORY) {
+      Interpret(cycles);
+      continue;
+    }
+    Block *block = blocks[pc] ? blocks[pc] : Compile(pc);
+    // Blocks run to completion, so a block larger than the remaining budget is interpreted instead
+    if (block->length == 0 || block->length > cycles) {
+      Interpret(cycles);
+      continue;
+    }
+    chip8->pc = block->code(chip8->V, &chip8->I);
+    chip8->opcode = block->lastOpcode;
+    chip8->cycle += block->length;
+    cycles -= block->length;
+  }
+}
+
+// Executes one instruction through the interpreter, which may fast-forward an idle loop over the rest of cycles
+void Jit::Interpret(unsigned long &cycles) {
+  chip8->cyclesLeft = cycles - 1;
+  chip8->EmulateCycle();
+  cycles = chip8->cyclesLeft;
+  chip8->cyclesLeft = 0;
+}
+
+// Drops every block whose source bytes overlap memory[address, address + length)
+void Jit::Invalidate(Word address, Word length) {
+  unsigned first = address > 2 * JIT_MAX_BLOCK ? address - 2 * JIT_MAX_BLOCK : 0;
+  unsigned last = std::min<unsigned>(address + length, MEMORY);
+  for (unsigned i = first; i < last; i++) {
+    if (blocks[i] && blocks[i]->end > address) {
+      delete blocks[i];
+      blocks[i] = nullptr;
+    }
+  }
+}
+
+Jit::Block *Jit::Compile(Word address) {
+  Block *block = new Block{nullptr, address, address, 0, 0};
+  bool terminator = false;
+  Word pc = address;
+
+  if (codeSize + (JIT_MAX_BLOCK + 1) * JIT_MAX_INSTRUCTION_BYTES > JIT_CODE_CACHE_SIZE)
+    Flush();
+
+  mprotect(codeCache, JIT_CODE_CACHE_SIZE, PROT_READ | PROT_WRITE);
+  std::size_t entry = codeSize;
+  while (!terminator && block->length < JIT_MAX_BLOCK && pc + 1 < MEMORY) {
+    Word opcode = (chip8->memory[pc] << 8) | chip8->memory[pc + 1];
+    if (!EmitInstruction(opcode, pc, terminator))
+      break;
+    block->lastOpcode = opcode;
+    block->length++;
+    pc += 2;
+  }
+  if (block->length == 0) {
+    // Nothing compilable here; remember that so the address is not retried
+    codeSize = entry;
+    block->end = address + 2;
+  } else {
+    if (!terminator) {
+      // mov eax, pc; ret
+      Emit({0xB8}); Emit32(pc); Emit({0xC3});
+    }
+    block->code = reinterpret_cast<BlockFunction>(codeCache + entry);
+    block->end = pc;
+  }
+  mprotect(codeCache, JIT_CODE_CACHE_SIZE, PROT_READ | PROT_EXEC);
+
+  blocks[address] = block;
+  return block;
+}
+
+// Emits x86-64 for one opcode (rdi = V, rsi = &I), mirroring the Chip8::op handlers.
+// Returns false for opcodes left to the interpreter.
+bool Jit::EmitInstruction(Word opcode, Word address, bool &terminator) {
+  Byte x = (opcode & 0x0F00) >> 8;
+  Byte y = (opcode & 0x00F0) >> 4;
+  Byte nn = opcode & 0x00FF;
+  Word nnn = opcode & 0x0FFF;
+
+  // Skips: eax = next PC, ecx = skipped PC, cmov on the comparison result
+  auto emitSkip = [&](Byte cmov) {
+    Emit({0xB8}); Emit32(address + 2);       // mov eax, pc + 2
+    Emit({0xB9}); Emit32(address + 4);       // mov ecx, pc + 4
+    Emit({0x0F, cmov, 0xC1});                // cmovcc eax, ecx
+    Emit({0xC3});                            // ret
+    terminator = true;
+  };
+
+  switch (opcode & 0xF000) {
+    // 0x1nnn - Jump to address nnn
+    case 0x1000:
+      Emit({0xB8}); Emit32(nnn);             // mov eax, nnn
+      Emit({0xC3});                          // ret
+      terminator = true;
+      return true;
+    // 0x3xbb - Skip next instruction if V[x] == bb
+    case 0x3000:
+      Emit({0x80, 0x7F, x, nn});             // cmp byte [rdi + x], bb
+      emitSkip(0x44);
+      return true;
+    // 0x4xbb - Skip next instruction if V[x] != bb
+    case 0x4000:
+      Emit({0x80, 0x7F, x, nn});             // cmp byte [rdi + x], bb
+      emitSkip(0x45);
+      return true;
+    // 0x5xy0 - Skip next instruction if V[x] == V[y]
+    case 0x5000:
+      Emit({0x8A, 0x47, x});                 // mov al, [rdi + x]
+      Emit({0x3A, 0x47, y});                 // cmp al, [rdi + y]
+      emitSkip(0x44);
+      return true;
+    // 0x6xbb - Load bb into V[x]
+    case 0x6000:
+      Emit({0xC6, 0x47, x, nn});             // mov byte [rdi + x], bb
+      return true;
+    // 0x7xbb - Increment V[x] by bb
+    case 0x7000:
+      Emit({0x80, 0x47, x, nn});             // add byte [rdi + x], bb
+      return true;
+    case 0x8000:
+      switch (opcode & 0x000F) {
+        // 0x8xy0 - Load V[y] into V[x]
+        case 0x0:
+          Emit({0x8A, 0x47, y});             // mov al, [rdi + y]
+          Emit({0x88, 0x47, x});             // mov [rdi + x], al
+          return true;
+        // 0x8xy1 / 0x8xy2 / 0x8xy3 - OR / AND / XOR V[y] into V[x]
+        case 0x1:
+        case 0x2:
+        case 0x3: {
+          Byte op = (opcode & 0x000F) == 0x1 ? 0x08 : (opcode & 0x000F) == 0x2 ? 0x20 : 0x30;
+          Emit({0x8A, 0x47, y});             // mov al, [rdi + y]
+          Emit({op, 0x47, x});               // or/and/xor [rdi + x], al
+          return true;
+        }
+        // 0x8xy4 - V[x] = V[x] + V[y]; V[F] = carry
+        case 0x4:
+          Emit({0x0F, 0xB6, 0x47, x});       // movzx eax, byte [rdi + x]
+          Emit({0x0F, 0xB6, 0x4F, y});       // movzx ecx, byte [rdi + y]
+          Emit({0x01, 0xC8});                // add eax, ecx
+          Emit({0x88, 0x47, x});             // mov [rdi + x], al
+          Emit({0xC1, 0xE8, 0x08});          // shr eax, 8
+          Emit({0x88, 0x47, 0x0F});          // mov [rdi + 0xF], al
+          return true;
+        // 0x8xy5 - V[F] = V[x] > V[y]; V[x] = V[x] - V[y]
+        case 0x5:
+          Emit({0x8A, 0x47, x});             // mov al, [rdi + x]
+          Emit({0x3A, 0x47, y});             // cmp al, [rdi + y]
+          Emit({0x0F, 0x97, 0xC2});          // seta dl
+          Emit({0x88, 0x57, 0x0F});          // mov [rdi + 0xF], dl
+          Emit({0x8A, 0x47, x});             // mov al, [rdi + x]
+          Emit({0x2A, 0x47, y});             // sub al, [rdi + y]
+          Emit({0x88, 0x47, x});             // mov [rdi + x], al
+          return true;
+        // 0x8xy6 - V[x] >>= 1; V[F] = V[x] & 1
+        case 0x6:
+          Emit({0xD0, 0x6F, x});             // shr byte [rdi + x], 1
+          Emit({0x8A, 0x47, x});             // mov al, [rdi + x]
+          Emit({0x24, 0x01});                // and al, 1
+          Emit({0x88, 0x47, 0x0F});          // mov [rdi + 0xF], al
+          return true;
+        // 0x8xy7 - V[x] = V[y] - V[x]; V[F] = V[y] > V[x]
+        case 0x7:
+          Emit({0x8A, 0x47, y});             // mov al, [rdi + y]
+          Emit({0x2A, 0x47, x});             // sub al, [rdi + x]
+          Emit({0x88, 0x47, x});             // mov [rdi + x], al
+          Emit({0x8A, 0x47, y});             // mov al, [rdi + y]
+          Emit({0x3A, 0x47, x});             // cmp al, [rdi + x]
+          Emit({0x0F, 0x97, 0xC2});          // seta dl
+          Emit({0x88, 0x57, 0x0F});          // mov [rdi + 0xF], dl
+          return true;
+        // 0x8xyE - V[x] <<= 1; V[F] = V[x] >> 7
+        case 0xE:
+          Emit({0xD0, 0x67, x});             // shl byte [rdi + x], 1
+          Emit({0x8A, 0x47, x});             // mov al, [rdi + x]
+          Emit({0xC0, 0xE8, 0x07});          // shr al, 7
+          Emit({0x88, 0x47, 0x0F});          // mov [rdi + 0xF], al
+          return true;
+      }
+      return false;
+    // 0x9xy0 - Skip next instruction if V[x] != V[y]
+    case 0x9000:
+      Emit({0x8A, 0x47, x});                 // mov al, [rdi + x]
+      Emit({0x3A, 0x47, y});                 // cmp al, [rdi + y]
+      emitSkip(0x45);
+      return true;
+    // 0xAnnn - Load nnn into I
+    case 0xA000:
+      Emit({0x66, 0xC7, 0x06}); Emit16(nnn); // mov word [rsi], nnn
+      return true;
+    case 0xF000:
+      switch (nn) {
+        // 0xFx1E - Set I = I + V[x]
+        case 0x1E:
+          Emit({0x0F, 0xB6, 0x47, x});       // movzx eax, byte [rdi + x]
+          Emit({0x66, 0x01, 0x06});          // add [rsi], ax
+          return true;
+        // 0xFx29 - Set I to the font sprite for V[x]
+        case 0x29:
+          Emit({0x0F, 0xB6, 0x47, x});       // movzx eax, byte [rdi + x]
+          Emit({0x8D, 0x04, 0x80});          // lea eax, [rax + rax * 4]
+          Emit({0x66, 0x89, 0x06});          // mov [rsi], ax
+          return true;
+      }
+      return false;
+  }
+  return false;
+}
+
+void Jit::Emit(std::initializer_list<Byte> bytes) {
+  for (Byte byte : bytes) {
+    codeCache[codeSize++] = byte;
+  }
+}
+
+void Jit::Emit16(Word value) {
+  Emit({static_cast<Byte>(value), static_cast<Byte>(value >> 8)});
+}
+
+void Jit::Emit32(unsigned value) {
+  Emit({static_cast<Byte>(value), static_cast<Byte>(value >> 8), static_cast<Byte>(value >> 16), static_cast<Byte>(value >> 24)});
+}
+
+// Discards every block once the code cache is full
+void Jit::Flush() {
+  for (int i = 0; i < MEMORY; i++) {
+    delete blocks[i];
+    blocks[i] = nullptr;
+  }
+  codeSize = 0;
+}
+
+Jit::~Jit() {
+  Flush();
+  if (codeCache)
+    munmap(codeCache, JIT_CODE_CACHE_SIZE);
+}
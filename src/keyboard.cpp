@@ -0,0 +1,58 @@
+#include "keyboard.h"
+#include <GLFW/glfw3.h>
+
+int virtualKeys[] = {
+  GLFW_KEY_1, // 0
+  GLFW_KEY_2, // 1
+  GLFW_KEY_3, // 2
+  GLFW_KEY_4, // 3
+  GLFW_KEY_Q, // 4
+  GLFW_KEY_W, // 5
+  GLFW_KEY_E, // 6
+  GLFW_KEY_R, // 7
+  GLFW_KEY_A, // 8
+  GLFW_KEY_S, // 9
+  GLFW_KEY_D, // A
+  GLFW_KEY_F, // B
+  GLFW_KEY_Z, // C
+  GLFW_KEY_X, // D
+  GLFW_KEY_C, // E
+  GLFW_KEY_V, // F
+};
+
+// GLFW callbacks carry no context, and there is a single window
+static Keyboard *keyboard = nullptr;
+
+Keyboard::Keyboard(GLFWwindow *window) {
+  this->window = window;
+  held = 0;
+  tapped = 0;
+  keyboard = this;
+  previousCallback = glfwSetKeyCallback(window, KeyCallback);
+}
+
+Keyboard::~Keyboard() {
+  glfwSetKeyCallback(window, previousCallback);
+  keyboard = nullptr;
+}
+
+void Keyboard::KeyCallback(GLFWwindow *window, int key, int scancode, int action, int mods) {
+  if (keyboard->previousCallback)
+    keyboard->previousCallback(window, key, scancode, action, mods);
+  for (int i = 0; i < 16; i++) {
+    if (virtualKeys[i] != key) continue;
+    if (action == GLFW_PRESS) {
+      keyboard->held |= 1 << i;
+      keyboard->tapped |= 1 << i;
+    }
+    else if (action == GLFW_RELEASE) {
+      keyboard->held &= ~(1 << i);
+    }
+  }
+}
+
+unsigned short Keyboard::Keys() {
+  unsigned short keys = held | tapped;
+  tapped = 0;
+  return keys;
+}
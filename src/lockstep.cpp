@@ -0,0 +1,695 @@
+#include "lockstep.h"
+#include "lanevector.h"
+#include <algorithm>
+#include <cstring>
+
+// Index into outcomeGroup: every PC, once running and once parked
+static inline std::size_t OutcomeKey(Word pc, bool parked) {
+  return pc | (parked ? 0x10000 : 0);
+}
+
+Chip8Lockstep::Chip8Lockstep(std::size_t lanes, unsigned long instructionsPerFrame) {
+  this->lanes = lanes;
+  this->instructionsPerFrame = instructionsPerFrame;
+  paddedLanes = (lanes + LANE_WIDTH - 1) / LANE_WIDTH * LANE_WIDTH;
+  stepsLeft = 0;
+  vectorLaneOps = 0;
+  scalarLaneOps = 0;
+  groups = 0;
+
+  for (std::size_t i = 0; i < lanes; i++) {
+    instances.push_back(std::make_unique<Chip8>(instructionsPerFrame * FRAME_RATE, DEBUG_FALSE));
+  }
+  for (int r = 0; r < 16; r++) {
+    V[r].assign(paddedLanes, 0);
+  }
+  I.assign(paddedLanes, 0);
+  delayTimer.assign(paddedLanes, 0);
+  soundTimer.assign(paddedLanes, 0);
+  keys.assign(lanes, 0);
+  stack.assign(lanes * 16, 0);
+  sp.assign(lanes, 0);
+  random.assign(lanes, Random{});
+  display.assign(lanes * DISPLAY_HEIGHT, 0);
+  std::memset(written, 0, sizeof(written));
+  nextPC.assign(lanes, 0);
+  nextParked.assign(lanes, 0);
+  outcomeGroup.assign(0x20000, 0);
+  condition.assign(paddedLanes, 0);
+}
+
+int Chip8Lockstep::LoadROM(const char *romPath) {
+  for (std::size_t i = 0; i < lanes; i++) {
+    Chip8 &chip8 = *instances[i];
+    if (!chip8.LoadROM(romPath))
+      return 0;
+    for (int r = 0; r < 16; r++) {
+      V[r][i] = chip8.V[r];
+    }
+    I[i] = chip8.I;
+    delayTimer[i] = chip8.delayTimer;
+    soundTimer[i] = chip8.soundTimer;
+    std::copy(chip8.stack, chip8.stack + 16, &stack[i * 16]);
+    sp[i] = chip8.sp;
+    random[i] = chip8.random;
+    std::copy(chip8.display, chip8.display + DISPLAY_HEIGHT, &display[i * DISPLAY_HEIGHT]);
+  }
+  // Every lane starts out in one group, with identical code
+  while (!active.empty()) {
+    spare.push_back(std::move(active.back()));
+    active.pop_back();
+  }
+  std::memset(written, 0, sizeof(written));
+  if (lanes > 0) {
+    std::size_t g = NewGroup(instances[0]->pc, false);
+    for (std::size_t i = 0; i < lanes; i++) {
+      active[g].lanes.push_back(i);
+    }
+  }
+  return 1;
+}
+
+// Takes effect from the next LoadROM, which re-seeds every lane
+void Chip8Lockstep::Seed(std::size_t lane, std::uint64_t seed) {
+  instances[lane]->Seed(seed);
+}
+
+// Lanes never go through RunCycles, so the keypad is latched as it is set
+void Chip8Lockstep::SetKeys(std::size_t lane, Word keys) {
+  this->keys[lane] = keys;
+}
+
+void Chip8Lockstep::RunFrames(unsigned long frames) {
+  for (unsigned long frame = 0; frame < frames; frame++) {
+    for (unsigned long i = 0; i < instructionsPerFrame; i++) {
+      stepsLeft = instructionsPerFrame - 1 - i;
+      Step();
+    }
+    stepsLeft = 0;
+    // Parked groups wake up for the next frame
+    for (LaneGroup &group : active) {
+      group.parked = false;
+    }
+    Merge();
+    // Timers decrement once per frame in every lane (saturating at 0)
+    for (std::size_t c = 0; c < paddedLanes; c += LANE_WIDTH) {
+      LaneStore(&delayTimer[c], LaneSubSaturate(LaneLoad(&delayTimer[c]), LaneSet(1)));
+      LaneStore(&soundTimer[c], LaneSubSaturate(LaneLoad(&soundTimer[c]), LaneSet(1)));
+    }
+  }
+}
+
+// Executes one instruction in every lane that is not parked. A group down to one lane has nothing left
+// to share a decode with, so it runs on to the end of the frame and parks there
+void Chip8Lockstep::Step() {
+  // Groups split off during this step have already run it
+  std::size_t count = active.size();
+  for (std::size_t g = 0; g < count; g++) {
+    if (active[g].parked)
+      continue;
+    groups++;
+    if (active[g].lanes.size() > 1) {
+      ExecuteGroup(g);
+      continue;
+    }
+    unsigned long left = stepsLeft;
+    ExecuteGroup(g);
+    while (!active[g].parked && stepsLeft > 0) {
+      stepsLeft--;
+      ExecuteGroup(g);
+    }
+    stepsLeft = left;
+    active[g].parked = true;
+  }
+  Merge();
+}
+
+// Takes a group (with its buffers) from the spare list, or makes one; returns its index in active
+std::size_t Chip8Lockstep::NewGroup(Word pc, bool parked) {
+  if (spare.empty())
+    spare.emplace_back();
+  active.push_back(std::move(spare.back()));
+  spare.pop_back();
+  LaneGroup &group = active.back();
+  group.pc = pc;
+  group.parked = parked;
+  group.maskValid = false;
+  group.lanes.clear();
+  return active.size() - 1;
+}
+
+// Rebuilds a group's lane mask and chunk list once its membership has changed
+void Chip8Lockstep::Prepare(LaneGroup &group) {
+  if (group.maskValid)
+    return;
+  group.mask.assign(paddedLanes, 0);
+  group.chunks.clear();
+  for (std::size_t lane : group.lanes) {
+    std::size_t chunk = lane / LANE_WIDTH * LANE_WIDTH;
+    group.mask[lane] = 0xFF;
+    if (group.chunks.empty() || group.chunks.back() != chunk)
+      group.chunks.push_back(chunk);
+  }
+  group.maskValid = true;
+}
+
+// Runs one instruction in every lane of a group, decoded once for all of them; the group splits
+// wherever its lanes end up at different PCs
+void Chip8Lockstep::ExecuteGroup(std::size_t g) {
+  LaneGroup &group = active[g];
+  Word address = group.pc & (MEMORY - 1);
+  // Every lane runs lane 0's code except where some lane stored into it; there the group's first
+  // lane decodes afresh (lanes' predecode caches are not kept up to date, see ExecuteScalar), and
+  // lanes holding different code move to a group of their own
+  bool shared = !written[address] && !written[(address + 1) & (MEMORY - 1)];
+  Chip8 &decoder = *instances[shared ? 0 : group.lanes[0]];
+  if (!shared || !decoder.decoded[address].execute)
+    decoder.Decode(address);
+  const Chip8::Instruction instruction = decoder.decoded[address];
+  std::size_t count = group.lanes.size();
+
+  if (!shared) {
+    std::size_t kept = 0;
+    merged.clear();
+    for (std::size_t lane : group.lanes) {
+      const Byte *memory = instances[lane]->memory;
+      if (((memory[address] << 8) | memory[(address + 1) & (MEMORY - 1)]) == instruction.opcode)
+        group.lanes[kept++] = lane;
+      else
+        merged.push_back(lane);
+    }
+    if (!merged.empty()) {
+      group.lanes.resize(kept);
+      group.maskValid = false;
+      std::size_t h = NewGroup(group.pc, false);
+      active[h].lanes.swap(merged);
+      ExecuteGroup(g);
+      ExecuteGroup(h);
+      return;
+    }
+  }
+
+  switch (instruction.operation) {
+    // As in Chip8::op1nnn, a jump closing a loop that only waits for the next frame idles the rest of it
+    case OP_1nnn:
+      vectorLaneOps += count;
+      if (stepsLeft > 0 && instruction.nnn == group.pc)
+        group.parked = true;
+      else if (stepsLeft > 0 && instruction.nnn + 4 == group.pc)
+        IdlePoll(g, instruction.nnn);
+      else
+        group.pc = instruction.nnn;
+      return;
+    case OP_3xnn:
+    case OP_4xnn:
+    case OP_5xy0:
+    case OP_9xy0:
+      if (count < LANE_WIDTH)
+        break;
+      Prepare(group);
+      ExecuteVector(group, instruction.opcode);
+      for (std::size_t m = 0; m < count; m++) {
+        nextPC[m] = group.pc + (condition[group.lanes[m]] ? 4 : 2);
+        nextParked[m] = false;
+      }
+      vectorLaneOps += count;
+      Split(g);
+      return;
+    case OP_6xnn:
+    case OP_7xnn:
+    case OP_8xy0:
+    case OP_8xy1:
+    case OP_8xy2:
+    case OP_8xy3:
+    case OP_8xy4:
+    case OP_8xy5:
+    case OP_8xy6:
+    case OP_8xy7:
+    case OP_8xyE:
+      if (count < LANE_WIDTH)
+        break;
+      Prepare(group);
+      ExecuteVector(group, instruction.opcode);
+      group.pc += 2;
+      vectorLaneOps += count;
+      return;
+    // 0xAnnn - Load nnn into I
+    case OP_Annn:
+      for (std::size_t lane : group.lanes) {
+        I[lane] = instruction.nnn;
+      }
+      group.pc += 2;
+      vectorLaneOps += count;
+      return;
+    // 0xFx07 - Set V[x] = delayTimer
+    case OP_Fx07:
+      for (std::size_t lane : group.lanes) {
+        V[instruction.x][lane] = delayTimer[lane];
+      }
+      group.pc += 2;
+      vectorLaneOps += count;
+      return;
+    // 0xFx15 - Set delayTimer = V[x]
+    case OP_Fx15:
+      for (std::size_t lane : group.lanes) {
+        delayTimer[lane] = V[instruction.x][lane];
+      }
+      group.pc += 2;
+      vectorLaneOps += count;
+      return;
+    // 0xFx18 - Set soundTimer = V[x]
+    case OP_Fx18:
+      for (std::size_t lane : group.lanes) {
+        soundTimer[lane] = V[instruction.x][lane];
+      }
+      group.pc += 2;
+      vectorLaneOps += count;
+      return;
+    // 0xFx1E - Set I = I + V[x]
+    case OP_Fx1E:
+      for (std::size_t lane : group.lanes) {
+        I[lane] += V[instruction.x][lane];
+      }
+      group.pc += 2;
+      vectorLaneOps += count;
+      return;
+    // 0xFx29 - Set I to the font sprite for V[x]
+    case OP_Fx29:
+      for (std::size_t lane : group.lanes) {
+        I[lane] = V[instruction.x][lane] * 5;
+      }
+      group.pc += 2;
+      vectorLaneOps += count;
+      return;
+    default:
+      break;
+  }
+
+  switch (instruction.operation) {
+    // Handlers whose next PC depends on the lane; a lane left waiting in Fx0A idles until the frame ends
+    case OP_00EE:
+    case OP_2nnn:
+    case OP_3xnn:
+    case OP_4xnn:
+    case OP_5xy0:
+    case OP_9xy0:
+    case OP_Bnnn:
+    case OP_Ex9E:
+    case OP_ExA1:
+    case OP_Fx0A:
+      for (std::size_t m = 0; m < count; m++) {
+        nextPC[m] = ExecuteScalar(group.lanes[m], group.pc, instruction.opcode, instruction.operation);
+        nextParked[m] = instruction.operation == OP_Fx0A && stepsLeft > 0 && nextPC[m] == group.pc;
+      }
+      scalarLaneOps += count;
+      Split(g);
+      return;
+    default: {
+      Word next = group.pc;
+      for (std::size_t lane : group.lanes) {
+        next = ExecuteScalar(lane, group.pc, instruction.opcode, instruction.operation);
+      }
+      group.pc = next;
+      scalarLaneOps += count;
+      return;
+    }
+  }
+}
+
+// The delay timer poll of Chip8::SkipIdleLoop (Fx07 / 3xnn or 4xnn on the same Vx / 1nnn back), lane by
+// lane: a lane whose timer keeps it looping parks where running out the frame would leave it, the others
+// take the jump. Lanes only skip while nobody has stored into the loop, so they all run its code
+void Chip8Lockstep::IdlePoll(std::size_t g, Word target) {
+  LaneGroup &group = active[g];
+  const Byte *memory = instances[group.lanes[0]]->memory;
+  Word read = (memory[target & (MEMORY - 1)] << 8) | memory[(target + 1) & (MEMORY - 1)];
+  Word test = (memory[(target + 2) & (MEMORY - 1)] << 8) | memory[(target + 3) & (MEMORY - 1)];
+  Byte x = (read >> 8) & 0xF;
+  Byte nn = test & 0xFF;
+  bool poll = (read & 0xF0FF) == 0xF007 && ((test >> 8) & 0xF) == x && (test >> 12 == 0x3 || test >> 12 == 0x4);
+  for (Word i = 0; i < 4; i++) {
+    if (written[(target + i) & (MEMORY - 1)])
+      poll = false;
+  }
+  Word parkedPC = target + 2 * (stepsLeft % 3);
+
+  for (std::size_t m = 0; m < group.lanes.size(); m++) {
+    std::size_t lane = group.lanes[m];
+    Byte delay = delayTimer[lane];
+    bool waits = poll && (test >> 12 == 0x3 ? delay != nn : delay == nn);
+    if (waits)
+      V[x][lane] = delay;
+    nextPC[m] = waits ? parkedPC : target;
+    nextParked[m] = waits;
+  }
+  Split(g);
+}
+
+// Regroups a group's lanes by the PC (and parked state) nextPC and nextParked give each member; lanes
+// sharing the first member's outcome stay in the group, the others join new groups after it
+void Chip8Lockstep::Split(std::size_t g) {
+  std::size_t count = active[g].lanes.size();
+  Word pc = nextPC[0];
+  bool parked = nextParked[0];
+  std::size_t m = 1;
+  while (m < count && nextPC[m] == pc && nextParked[m] == parked) {
+    m++;
+  }
+  active[g].pc = pc;
+  active[g].parked = parked;
+  if (m == count)
+    return;
+
+  std::size_t created = active.size();
+  std::size_t kept = m;
+  outcomeGroup[OutcomeKey(pc, parked)] = g + 1;
+  for (; m < count; m++) {
+    std::uint32_t &slot = outcomeGroup[OutcomeKey(nextPC[m], nextParked[m])];
+    if (!slot)
+      slot = NewGroup(nextPC[m], nextParked[m]) + 1;
+    std::size_t lane = active[g].lanes[m];
+    if (slot == g + 1)
+      active[g].lanes[kept++] = lane;
+    else
+      active[slot - 1].lanes.push_back(lane);
+  }
+  active[g].lanes.resize(kept);
+  active[g].maskValid = false;
+  outcomeGroup[OutcomeKey(pc, parked)] = 0;
+  for (std::size_t h = created; h < active.size(); h++) {
+    outcomeGroup[OutcomeKey(active[h].pc, active[h].parked)] = 0;
+  }
+}
+
+// Joins groups that have reached the same PC (and parked state), then recycles the emptied ones
+void Chip8Lockstep::Merge() {
+  bool emptied = false;
+  if (active.size() < 2)
+    return;
+  for (std::size_t g = 0; g < active.size(); g++) {
+    std::uint32_t &slot = outcomeGroup[OutcomeKey(active[g].pc, active[g].parked)];
+    if (!slot) {
+      slot = g + 1;
+      continue;
+    }
+    LaneGroup &into = active[slot - 1];
+    LaneGroup &from = active[g];
+    merged.resize(into.lanes.size() + from.lanes.size());
+    std::merge(into.lanes.begin(), into.lanes.end(), from.lanes.begin(), from.lanes.end(), merged.begin());
+    into.lanes.swap(merged);
+    into.maskValid = false;
+    from.lanes.clear();
+    emptied = true;
+  }
+  for (const LaneGroup &group : active) {
+    outcomeGroup[OutcomeKey(group.pc, group.parked)] = 0;
+  }
+  if (!emptied)
+    return;
+  std::size_t kept = 0;
+  for (std::size_t g = 0; g < active.size(); g++) {
+    if (active[g].lanes.empty())
+      spare.push_back(std::move(active[g]));
+    else if (kept++ != g)
+      active[kept - 1] = std::move(active[g]);
+  }
+  active.resize(kept);
+}
+
+// Masked kernels mirroring Chip8::op3xnn .. op8xyE, including the order in
+// which V[x] and V[F] are written when x or y is 0xF. Only the chunks holding
+// the group's lanes are touched; skips leave their outcome in condition
+void Chip8Lockstep::ExecuteVector(LaneGroup &group, Word opcode) {
+  Byte x = (opcode & 0x0F00) >> 8;
+  Byte y = (opcode & 0x00F0) >> 4;
+  Byte nn = opcode & 0x00FF;
+  Byte *Vx = V[x].data();
+  Byte *Vy = V[y].data();
+  Byte *VF = V[0xF].data();
+  LaneVector one = LaneSet(1);
+
+  switch (opcode & 0xF000) {
+    // 0x3xbb / 0x4xbb - Skip if V[x] == bb / V[x] != bb
+    case 0x3000:
+    case 0x4000: {
+      LaneVector invert = LaneSet((opcode & 0xF000) == 0x4000 ? 0xFF : 0x00);
+      for (std::size_t c : group.chunks) {
+        LaneStore(&condition[c], LaneXor(LaneEqual(LaneLoad(&Vx[c]), LaneSet(nn)), invert));
+      }
+      return;
+    }
+    // 0x5xy0 / 0x9xy0 - Skip if V[x] == V[y] / V[x] != V[y]
+    case 0x5000:
+    case 0x9000: {
+      LaneVector invert = LaneSet((opcode & 0xF000) == 0x9000 ? 0xFF : 0x00);
+      for (std::size_t c : group.chunks) {
+        LaneStore(&condition[c], LaneXor(LaneEqual(LaneLoad(&Vx[c]), LaneLoad(&Vy[c])), invert));
+      }
+      return;
+    }
+  }
+
+  for (std::size_t c : group.chunks) {
+    LaneVector mask = LaneLoad(&group.mask[c]);
+    LaneVector vx = LaneLoad(&Vx[c]);
+    LaneVector vy = LaneLoad(&Vy[c]);
+
+    switch (opcode & 0xF000) {
+      // 0x6xbb - Load bb into V[x]
+      case 0x6000:
+        LaneStore(&Vx[c], LaneSelect(mask, vx, LaneSet(nn)));
+        break;
+      // 0x7xbb - Increment V[x] by bb
+      case 0x7000:
+        LaneStore(&Vx[c], LaneSelect(mask, vx, LaneAdd(vx, LaneSet(nn))));
+        break;
+      case 0x8000:
+        switch (opcode & 0x000F) {
+          // 0x8xy0 - Load V[y] into V[x]
+          case 0x0:
+            LaneStore(&Vx[c], LaneSelect(mask, vx, vy));
+            break;
+          // 0x8xy1 - V[x] |= V[y]
+          case 0x1:
+            LaneStore(&Vx[c], LaneSelect(mask, vx, LaneOr(vx, vy)));
+            break;
+          // 0x8xy2 - V[x] &= V[y]
+          case 0x2:
+            LaneStore(&Vx[c], LaneSelect(mask, vx, LaneAnd(vx, vy)));
+            break;
+          // 0x8xy3 - V[x] ^= V[y]
+          case 0x3:
+            LaneStore(&Vx[c], LaneSelect(mask, vx, LaneXor(vx, vy)));
+            break;
+          // 0x8xy4 - V[x] += V[y]; V[F] = carry
+          case 0x4: {
+            LaneVector sum = LaneAdd(vx, vy);
+            LaneVector carry = LaneGreater(vx, sum);
+            LaneStore(&Vx[c], LaneSelect(mask, vx, sum));
+            LaneStore(&VF[c], LaneSelect(mask, LaneLoad(&VF[c]), LaneAnd(carry, one)));
+            break;
+          }
+          // 0x8xy5 - V[F] = V[x] > V[y]; V[x] = V[x] - V[y]
+          case 0x5: {
+            LaneVector borrow = LaneGreater(vx, vy);
+            LaneStore(&VF[c], LaneSelect(mask, LaneLoad(&VF[c]), LaneAnd(borrow, one)));
+            vx = LaneLoad(&Vx[c]);
+            vy = LaneLoad(&Vy[c]);
+            LaneStore(&Vx[c], LaneSelect(mask, vx, LaneSub(vx, vy)));
+            break;
+          }
+          // 0x8xy6 - V[x] >>= 1; V[F] = V[x] & 1
+          case 0x6:
+            LaneStore(&Vx[c], LaneSelect(mask, vx, LaneShiftRight1(vx)));
+            vx = LaneLoad(&Vx[c]);
+            LaneStore(&VF[c], LaneSelect(mask, LaneLoad(&VF[c]), LaneAnd(vx, one)));
+            break;
+          // 0x8xy7 - V[x] = V[y] - V[x]; V[F] = V[y] > V[x]
+          case 0x7:
+            LaneStore(&Vx[c], LaneSelect(mask, vx, LaneSub(vy, vx)));
+            vx = LaneLoad(&Vx[c]);
+            vy = LaneLoad(&Vy[c]);
+            LaneStore(&VF[c], LaneSelect(mask, LaneLoad(&VF[c]), LaneAnd(LaneGreater(vy, vx), one)));
+            break;
+          // 0x8xyE - V[x] <<= 1; V[F] = V[x] >> 7
+          case 0xE:
+            LaneStore(&Vx[c], LaneSelect(mask, vx, LaneAdd(vx, vx)));
+            vx = LaneLoad(&Vx[c]);
+            LaneStore(&VF[c], LaneSelect(mask, LaneLoad(&VF[c]), LaneAnd(LaneGreater(vx, LaneSet(0x7F)), one)));
+            break;
+        }
+        break;
+    }
+  }
+}
+
+// Runs one instruction for one lane, on the lane's state where it sits in the arrays and on its Chip8's
+// memory; mirrors the Chip8::op handlers (jumps and the I and timer loads run per group). Stores mark
+// written instead of invalidating the lane's predecode cache, which lockstep never reads there.
+// Returns the next PC
+Word Chip8Lockstep::ExecuteScalar(std::size_t lane, Word pc, Word opcode, Byte operation) {
+  Chip8 &chip8 = *instances[lane];
+  Byte x = (opcode & 0x0F00) >> 8;
+  Byte y = (opcode & 0x00F0) >> 4;
+  Byte n = opcode & 0x000F;
+  Byte nn = opcode & 0x00FF;
+  Word nnn = opcode & 0x0FFF;
+  Byte &Vx = V[x][lane];
+  Word &index = I[lane];
+  std::uint64_t *rows = &display[lane * DISPLAY_HEIGHT];
+
+  switch (operation) {
+    // 0x00E0 - Clear Screen
+    case OP_00E0:
+      std::fill(rows, rows + DISPLAY_HEIGHT, 0);
+      return pc + 2;
+    // 0x00EE - Return
+    case OP_00EE: {
+      if (sp[lane] <= 0)
+        return pc;
+      Word next = stack[lane * 16 + --sp[lane]] + 2;
+      stack[lane * 16 + sp[lane]] = 0;
+      return next;
+    }
+    // 0x2nnn - Call function at nnn
+    case OP_2nnn:
+      if (sp[lane] >= 16)
+        return pc + 2;
+      stack[lane * 16 + sp[lane]++] = pc;
+      return nnn;
+    // 0x3xbb / 0x4xbb - Skip next instruction if V[x] == bb / V[x] != bb
+    case OP_3xnn:
+      return Vx == nn ? pc + 4 : pc + 2;
+    case OP_4xnn:
+      return Vx != nn ? pc + 4 : pc + 2;
+    // 0x5xy0 / 0x9xy0 - Skip next instruction if V[x] == V[y] / V[x] != V[y]
+    case OP_5xy0:
+      return Vx == V[y][lane] ? pc + 4 : pc + 2;
+    case OP_9xy0:
+      return Vx != V[y][lane] ? pc + 4 : pc + 2;
+    // 0x6xbb - Load bb into V[x]
+    case OP_6xnn:
+      Vx = nn;
+      return pc + 2;
+    // 0x7xbb - Increment V[x] by bb
+    case OP_7xnn:
+      Vx += nn;
+      return pc + 2;
+    // 0x8xy0 - Load V[y] into V[x]
+    case OP_8xy0:
+      Vx = V[y][lane];
+      return pc + 2;
+    // 0x8xy1 / 0x8xy2 / 0x8xy3 - V[x] |= V[y] / V[x] &= V[y] / V[x] ^= V[y]
+    case OP_8xy1:
+      Vx |= V[y][lane];
+      return pc + 2;
+    case OP_8xy2:
+      Vx &= V[y][lane];
+      return pc + 2;
+    case OP_8xy3:
+      Vx ^= V[y][lane];
+      return pc + 2;
+    // 0x8xy4 - V[x] += V[y]; V[F] = carry
+    case OP_8xy4: {
+      Word sum = Vx + V[y][lane];
+      Vx = sum & 0xFF;
+      V[0xF][lane] = sum > 0xFF;
+      return pc + 2;
+    }
+    // 0x8xy5 - V[F] = V[x] > V[y]; V[x] = V[x] - V[y]
+    case OP_8xy5:
+      V[0xF][lane] = Vx > V[y][lane];
+      Vx = Vx - V[y][lane];
+      return pc + 2;
+    // 0x8xy6 - V[x] >>= 1; V[F] = V[x] & 1
+    case OP_8xy6:
+      Vx = Vx >> 1;
+      V[0xF][lane] = Vx & 0x01;
+      return pc + 2;
+    // 0x8xy7 - V[x] = V[y] - V[x]; V[F] = V[y] > V[x]
+    case OP_8xy7:
+      Vx = V[y][lane] - Vx;
+      V[0xF][lane] = V[y][lane] > Vx;
+      return pc + 2;
+    // 0x8xyE - V[x] <<= 1; V[F] = V[x] >> 7
+    case OP_8xyE:
+      Vx = Vx << 1;
+      V[0xF][lane] = (Vx & 0x80) == 0x80;
+      return pc + 2;
+    // 0xBnnn - Jump to address nnn + V[0]
+    case OP_Bnnn:
+      return (V[0][lane] + opcode) & 0x0FFF;
+    // 0xCxbb - Set V[x] = random(0, 255) AND bb
+    case OP_Cxnn:
+      Vx = (random[lane].Next() >> 24) & nn;
+      return pc + 2;
+    // 0xDxyn - Draw a sprite of n-bytes high at (V[x], V[y])
+    case OP_Dxyn: {
+      const Byte *memory = LaneMemory(lane, index, n);
+      Byte column = Vx % DISPLAY_WIDTH;
+      Byte row = V[y][lane] % DISPLAY_HEIGHT;
+      std::uint64_t collision = 0;
+      for (int i = 0; i < n; i++) {
+        if (row + i >= DISPLAY_HEIGHT) break;
+        if (index + i >= MEMORY) break;
+        std::uint64_t spriteRow = static_cast<std::uint64_t>(memory[index + i]) << (DISPLAY_WIDTH - 8) >> column;
+        collision |= rows[row + i] & spriteRow;
+        rows[row + i] ^= spriteRow;
+      }
+      V[0xF][lane] = collision != 0;
+      return pc + 2;
+    }
+    // 0xEx9E / 0xExA1 - Skip next instruction if the key value of V[x] is / is NOT pressed
+    case OP_Ex9E:
+      return (keys[lane] >> (Vx & 0xF)) & 1 ? pc + 4 : pc + 2;
+    case OP_ExA1:
+      return (keys[lane] >> (Vx & 0xF)) & 1 ? pc + 2 : pc + 4;
+    // 0xFx0A - Wait for input and store the key value in V[x] (the highest held key, as Chip8::PressedKey)
+    case OP_Fx0A:
+      if (!keys[lane])
+        return pc;
+      Vx = std::bit_width(keys[lane]) - 1;
+      return pc + 2;
+    // 0xFx33 - Store BCD representation of V[x] at memory locations I, I + 1, I + 2
+    case OP_Fx33:
+      chip8.memory[index] = Vx / 100;
+      chip8.memory[index + 1] = (Vx % 100) / 10;
+      chip8.memory[index + 2] = Vx % 10;
+      MarkWritten(index, 3);
+      return pc + 2;
+    // 0xFx55 - Store values from registers V[0] to V[x] into memory[I] onwards
+    case OP_Fx55:
+      for (int i = 0; i <= x && index + i < MEMORY; i++) {
+        chip8.memory[index + i] = V[i][lane];
+      }
+      MarkWritten(index, x + 1);
+      return pc + 2;
+    // 0xFx65 - Store values starting from memory[I] into registers V[0] to V[x]
+    case OP_Fx65: {
+      const Byte *memory = LaneMemory(lane, index, x + 1);
+      for (int i = 0; i <= x && index + i < MEMORY; i++) {
+        V[i][lane] = memory[index + i];
+      }
+      return pc + 2;
+    }
+  }
+  // Unassigned opcodes leave the PC where it is
+  return pc;
+}
+
+// Notes stored addresses, where lanes' memory may no longer match lane 0's
+void Chip8Lockstep::MarkWritten(Word address, Word length) {
+  for (unsigned i = address; i < std::min<unsigned>(address + length, MEMORY); i++) {
+    written[i] = 1;
+  }
+}
+
+// Memory to read [address, address + length) of a lane from: lane 0's, which every lane shares and
+// which stays in cache, unless some lane has stored into the range
+const Byte *Chip8Lockstep::LaneMemory(std::size_t lane, Word address, Word length) const {
+  for (unsigned i = address; i < std::min<unsigned>(address + length, MEMORY); i++) {
+    if (written[i])
+      return instances[lane]->memory;
+  }
+  return instances[0]->memory;
+}
@@ -0,0 +1,97 @@
+#include "profile.h"
+#include <algorithm>
+#include <cstring>
+
+#define CHIP8_OPERATION_NAME(name) #name,
+static const char *const operationNames[OP_COUNT] = { CHIP8_OPERATIONS(CHIP8_OPERATION_NAME) };
+#undef CHIP8_OPERATION_NAME
+
+const char *OperationName(int operation) {
+  return operationNames[operation];
+}
+
+int OperationClass(int operation) {
+  if (operation == OP_Unknown) return -1;
+  char nibble = operationNames[operation][0];
+  return nibble <= '9' ? nibble - '0' : nibble - 'A' + 10;
+}
+
+void Profile::Clear() {
+  std::memset(counts, 0, sizeof(counts));
+  std::memset(samples, 0, sizeof(samples));
+  std::memset(ticks, 0, sizeof(ticks));
+  std::memset(histogram, 0, sizeof(histogram));
+  std::memset(visits, 0, sizeof(visits));
+  fastForwarded = 0;
+}
+
+unsigned long long Profile::Total() const {
+  unsigned long long total = 0;
+  for (int i = 0; i < OP_COUNT; i++) total += counts[i];
+  return total;
+}
+
+unsigned long long Profile::MaxVisits() const {
+  return *std::max_element(visits, visits + PROFILE_ADDRESSES);
+}
+
+// Fills addresses with up to count of the most fetched addresses, hottest first, and returns how many were found
+int Profile::HotAddresses(int *addresses, int count) const {
+  int order[PROFILE_ADDRESSES];
+  int found = 0;
+  for (int i = 0; i < PROFILE_ADDRESSES; i++) {
+    if (visits[i]) order[found++] = i;
+  }
+  count = std::min(count, found);
+  std::partial_sort(order, order + count, order + found, [&](int a, int b) {
+    return visits[a] > visits[b] || (visits[a] == visits[b] && a < b);
+  });
+  std::copy(order, order + count, addresses);
+  return count;
+}
+
+// Operations by descending count, then per-class totals
+void Profile::Dump(std::FILE *out) const {
+  unsigned long long total = Total();
+  unsigned long long classCounts[16] = {};
+  int order[OP_COUNT];
+  if (total == 0)
+    return;
+
+  for (int i = 0; i < OP_COUNT; i++) order[i] = i;
+  std::stable_sort(order, order + OP_COUNT, [&](int a, int b) { return counts[a] > counts[b]; });
+
+  std::fprintf(out, "operation       count       %%");
+#ifdef CHIP8_PROFILE_TIMING
+  std::fprintf(out, "   avg ticks  histogram (log2 ticks: count)");
+#endif
+  std::fprintf(out, "\n");
+  for (int i : order) {
+    if (!counts[i]) continue;
+    std::fprintf(out, "%-9s %12llu %6.2f", operationNames[i], counts[i], 100.0 * counts[i] / total);
+#ifdef CHIP8_PROFILE_TIMING
+    std::fprintf(out, " %11.1f ", samples[i] ? double(ticks[i]) / samples[i] : 0.0);
+    for (int b = 0; b < PROFILE_BUCKETS; b++) {
+      if (histogram[i][b]) std::fprintf(out, " %d:%llu", b, histogram[i][b]);
+    }
+#endif
+    std::fprintf(out, "\n");
+    if (OperationClass(i) >= 0) classCounts[OperationClass(i)] += counts[i];
+  }
+
+  std::fprintf(out, "\nclass           count       %%\n");
+  for (int c = 0; c < 16; c++) {
+    if (classCounts[c])
+      std::fprintf(out, "%Xxxx      %12llu %6.2f\n", c, classCounts[c], 100.0 * classCounts[c] / total);
+  }
+
+  int hot[PROFILE_HOT_ADDRESSES];
+  int hotCount = HotAddresses(hot, PROFILE_HOT_ADDRESSES);
+  std::fprintf(out, "\naddress         count       %%\n");
+  for (int i = 0; i < hotCount; i++) {
+    std::fprintf(out, "0x%.3X     %12llu %6.2f\n", hot[i], visits[hot[i]], 100.0 * visits[hot[i]] / total);
+  }
+  if (fastForwarded)
+    std::fprintf(out, "\n%llu of these (%.2f%%) were idle loop or Fx0A instructions fast-forwarded instead of run\n",
+                 fastForwarded, 100.0 * fastForwarded / total);
+}
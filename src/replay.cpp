@@ -0,0 +1,102 @@
+#include "replay.h"
+#include "savestate.h"
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+Replay::Replay() {
+  Begin(0, 0);
+}
+
+// Starts an empty recording; the key mask after a reset is 0
+void Replay::Begin(std::uint64_t seed, std::uint64_t romHash) {
+  this->seed = seed;
+  this->romHash = romHash;
+  cycles = 0;
+  stateHash = 0;
+  events.clear();
+  lastCycle = 0;
+  lastKeys = 0;
+}
+
+void Replay::PutEvent(std::uint64_t cycle, bool keyChange) {
+  std::uint64_t value = (cycle - lastCycle) << 1 | keyChange;
+  lastCycle = cycle;
+  do {
+    unsigned char byte = value & 0x7F;
+    value >>= 7;
+    events.push_back(byte | (value ? 0x80 : 0));
+  } while (value);
+}
+
+// Only changes are stored, so polling the same mask every instruction costs nothing
+void Replay::RecordKeys(std::uint64_t cycle, unsigned short keys) {
+  if (keys == lastKeys)
+    return;
+  PutEvent(cycle, true);
+  events.push_back(keys & 0xFF);
+  events.push_back(keys >> 8);
+  lastKeys = keys;
+}
+
+void Replay::RecordTick(std::uint64_t cycle) {
+  PutEvent(cycle, false);
+}
+
+void Replay::End(std::uint64_t cycles, std::uint64_t stateHash) {
+  this->cycles = cycles;
+  this->stateHash = stateHash;
+}
+
+std::vector<ReplayEvent> Replay::Events() const {
+  std::vector<ReplayEvent> decoded;
+  std::uint64_t cycle = 0;
+  std::size_t i = 0;
+  while (i < events.size()) {
+    std::uint64_t value = 0;
+    for (int shift = 0; i < events.size() && shift < 64; shift += 7) {
+      unsigned char byte = events[i++];
+      value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+      if (!(byte & 0x80)) break;
+    }
+    cycle += value >> 1;
+    ReplayEvent event = { cycle, static_cast<bool>(value & 1), 0 };
+    if (event.keyChange) {
+      if (i + 2 > events.size()) break;
+      event.keys = StateGet16(&events[i]);
+      i += 2;
+    }
+    decoded.push_back(event);
+  }
+  return decoded;
+}
+
+bool Replay::Save(const char *path) const {
+  std::ofstream file(path, std::ios::binary);
+  unsigned char header[REPLAY_HEADER_SIZE] = {};
+  if (!file.is_open())
+    return false;
+
+  std::memcpy(header, REPLAY_MAGIC, 4);
+  StatePut16(header + 4, REPLAY_VERSION);
+  StatePut64(header + 8, seed);
+  StatePut64(header + 16, romHash);
+  StatePut64(header + 24, cycles);
+  StatePut64(header + 32, stateHash);
+  file.write(reinterpret_cast<const char *>(header), sizeof(header));
+  file.write(reinterpret_cast<const char *>(events.data()), events.size());
+  return file.good();
+}
+
+bool Replay::Load(const char *path) {
+  std::ifstream file(path, std::ios::binary);
+  std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  if (data.size() < REPLAY_HEADER_SIZE || std::memcmp(data.data(), REPLAY_MAGIC, 4) != 0 ||
+      StateGet16(&data[4]) != REPLAY_VERSION)
+    return false;
+
+  Begin(StateGet64(&data[8]), StateGet64(&data[16]));
+  End(StateGet64(&data[24]), StateGet64(&data[32]));
+  events.assign(data.begin() + REPLAY_HEADER_SIZE, data.end());
+  return true;
+}
@@ -0,0 +1,115 @@
+#include "rewind.h"
+#include <algorithm>
+
+Rewind::Rewind(std::size_t stateSize, std::size_t capacity, std::size_t keyframeInterval) {
+  this->stateSize = stateSize;
+  this->capacity = capacity;
+  this->keyframeInterval = keyframeInterval;
+  sinceKeyframe = 0;
+  bytes = 0;
+}
+
+void Rewind::Clear() {
+  snapshots.clear();
+  sinceKeyframe = 0;
+  bytes = 0;
+}
+
+void Rewind::Push(const unsigned char *state) {
+  Snapshot snapshot;
+  if (snapshots.empty() || sinceKeyframe >= keyframeInterval) {
+    keyframe.assign(state, state + stateSize);
+    RunLengthEncode(state, stateSize, snapshot.data);
+    snapshot.keyframe = true;
+    sinceKeyframe = 1;
+  }
+  else {
+    scratch.resize(stateSize);
+    for (std::size_t i = 0; i < stateSize; i++) {
+      scratch[i] = state[i] ^ keyframe[i];
+    }
+    RunLengthEncode(scratch.data(), stateSize, snapshot.data);
+    snapshot.keyframe = false;
+    sinceKeyframe++;
+  }
+  bytes += snapshot.data.size();
+  snapshots.push_back(std::move(snapshot));
+  Evict();
+}
+
+// Drops the oldest keyframe group(s) once over capacity, since deltas are useless without their keyframe
+void Rewind::Evict() {
+  if (snapshots.size() <= capacity)
+    return;
+  do {
+    bytes -= snapshots.front().data.size();
+    snapshots.pop_front();
+  } while (!snapshots.empty() && !snapshots.front().keyframe);
+}
+
+bool Rewind::Pop(unsigned char *state) {
+  if (snapshots.empty())
+    return false;
+
+  Snapshot &newest = snapshots.back();
+  RunLengthDecode(newest.data.data(), newest.data.size(), state, stateSize);
+  if (!newest.keyframe) {
+    for (std::size_t i = 0; i < stateSize; i++) {
+      state[i] ^= keyframe[i];
+    }
+  }
+  bool wasKeyframe = newest.keyframe;
+  bytes -= newest.data.size();
+  snapshots.pop_back();
+  sinceKeyframe--;
+
+  // Stepping back past a keyframe makes the previous group the newest one
+  if (wasKeyframe) {
+    auto group = std::find_if(snapshots.rbegin(), snapshots.rend(), [](const Snapshot &s) { return s.keyframe; });
+    sinceKeyframe = group - snapshots.rbegin() + (group != snapshots.rend());
+    if (group != snapshots.rend()) {
+      keyframe.resize(stateSize);
+      RunLengthDecode(group->data.data(), group->data.size(), keyframe.data(), stateSize);
+    }
+  }
+  return true;
+}
+
+void RunLengthEncode(const unsigned char *source, std::size_t size, std::vector<unsigned char> &out) {
+  std::size_t i = 0;
+  out.clear();
+  while (i < size) {
+    std::size_t run = 1;
+    while (i + run < size && run < 128 && source[i + run] == source[i]) run++;
+    if (run >= 2) {
+      out.push_back(run - 1);
+      out.push_back(source[i]);
+      i += run;
+      continue;
+    }
+    // Literals continue until the next pair of equal bytes
+    std::size_t start = i;
+    while (i < size && i - start < 128 && (i + 1 >= size || source[i + 1] != source[i])) i++;
+    out.push_back(127 + (i - start));
+    out.insert(out.end(), source + start, source + i);
+  }
+}
+
+void RunLengthDecode(const unsigned char *source, std::size_t size, unsigned char *out, std::size_t outSize) {
+  std::size_t i = 0, o = 0;
+  while (i < size && o < outSize) {
+    unsigned char control = source[i++];
+    if (control < 128) {
+      std::size_t run = std::min<std::size_t>(control + 1, outSize - o);
+      if (i >= size) break;
+      std::fill(out + o, out + o + run, source[i++]);
+      o += run;
+    }
+    else {
+      std::size_t length = std::min<std::size_t>({std::size_t(control - 127), outSize - o, size - i});
+      std::copy(source + i, source + i + length, out + o);
+      i += length;
+      o += length;
+    }
+  }
+}
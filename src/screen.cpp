@@ -2,21 +2,26 @@
 #include "GLFW/glfw3.h"
 #include "chip8.h"
 #include "utilities.h"
+#include "allocations.h"
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 #include <cstdarg>
 #include <cstring>
-#include <ios>
-#include <ostream>
-#include <sstream>
 #include <filesystem>
 #include <vector>
-#include <iomanip>
 #include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
 
 namespace fs = std::filesystem;
 
+typedef Utilities::FixedString<32> StateLine;
+static const char *const hexNibbles[] = { "0", "1", "2", "3", "4", "5", "6", "7",
+                                          "8", "9", "A", "B", "C", "D", "E", "F" };
+
 void framebufferSizeCallback(GLFWwindow *window, int width, int height);
 
 Screen::Screen(const char *vsPath, const char *fsPath, Chip8 *chip8) {
@@ -49,6 +54,8 @@ Screen::Screen(const char *vsPath, const char *fsPath, Chip8 *chip8) {
   }
 
   glfwMakeContextCurrent(window);
+  // Vsync: glfwSwapBuffers blocks until the next vertical blank instead of letting Draw spin
+  glfwSwapInterval(1);
 
   // GLAD
   if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
@@ -64,7 +71,10 @@ Screen::Screen(const char *vsPath, const char *fsPath, Chip8 *chip8) {
   // Texture
   glGenTextures(1, &texture);
   glActiveTexture(GL_TEXTURE0);
-  UpdateTextureData();
+  std::memcpy(shownRows, chip8->GetDisplay(), sizeof(shownRows));
+  std::fill(changedAt, changedAt + MEMORY, 0);
+  draws = 0;
+  UpdateTextureData(0xFFFFFFFF);
   glBindTexture(GL_TEXTURE_2D, texture);
   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, DISPLAY_WIDTH, DISPLAY_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, textureData->data());
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -98,9 +108,11 @@ Screen::Screen(const char *vsPath, const char *fsPath, Chip8 *chip8) {
   // Callbacks
   glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
 
-  // ImGui
+  // ImGui (allocations are counted for the UI Allocations readout)
   IMGUI_CHECKVERSION();
+  ImGui::SetAllocatorFunctions(CountedAlloc, CountedFree);
   ImGui::CreateContext();
+  uiAllocations = 0;
   ImGuiIO &io = ImGui::GetIO();
   io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
   io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;
@@ -112,46 +124,91 @@ Screen::Screen(const char *vsPath, const char *fsPath, Chip8 *chip8) {
 void Screen::Draw() {
   glfwPollEvents();
 
+  // Everything from here to ImGui::Render should be allocation-free once the windows have settled
+  unsigned long long allocations = ThreadAllocations();
   ImGui_ImplOpenGL3_NewFrame();
   ImGui_ImplGlfw_NewFrame();
   ImGui::NewFrame();
 
-  // Draw to FBO
-  glBindFramebuffer(GL_FRAMEBUFFER, FBO);
-  glClear(GL_COLOR_BUFFER_BIT);
-  glViewport(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT);
-  glBindVertexArray(VAO);
-  shader->use();
-  shader->setInt("texSample", 0);
-  UpdateTextureData();
-  glBindTexture(GL_TEXTURE_2D, texture);
-  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, textureData->data());
-  glDrawArrays(GL_TRIANGLES, 0, 6);
-  GLenum err = glGetError();
-  if (err != GL_NO_ERROR) std::cout << "GL Error: " << err << "\n";
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  // Newest snapshot from the emulation thread; rows are compared because snapshots in between may have been skipped
+  std::uint32_t rows = 0;
+  if (chip8->TakeSnapshot()) {
+    const Snapshot &state = chip8->GetSnapshot();
+    for (int y = 0; y < DISPLAY_HEIGHT; y++) {
+      if (state.rows[y] != shownRows[y]) rows |= 1u << y;
+      shownRows[y] = state.rows[y];
+    }
+  }
+
+  // Draw to FBO (skipped entirely while the display is unchanged)
+  if (rows) {
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glViewport(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+    glBindVertexArray(VAO);
+    shader->use();
+    shader->setInt("texSample", 0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    UploadRows(rows);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR) std::cout << "GL Error: " << err << "\n";
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  }
 
   // Draw
   glViewport(0, 0, WIDTH, HEIGHT);
   glClear(GL_COLOR_BUFFER_BIT);
   glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+  // The windows read the snapshot and send changes as commands, so the emulation thread never waits on them
   Debugger();
   MenuBar();
 
   // ImGui Render
   ImGui::Render();
+  uiAllocations = ThreadAllocations() - allocations;
   ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
   // Poll Events & Swap Buffers
   glfwSwapBuffers(window);
 }
 
-void Screen::UpdateTextureData() {
-  for (unsigned int i = 0; i < DISPLAY_WIDTH * DISPLAY_HEIGHT; i++) {
-    (*textureData)[i * 4]     = chip8->display[i] * 255;
-    (*textureData)[i * 4 + 1] = chip8->display[i] * 255;
-    (*textureData)[i * 4 + 2] = chip8->display[i] * 255;
-    (*textureData)[i * 4 + 3] = 255;
+bool Screen::IsOpen() {
+  return !glfwWindowShouldClose(window);
+}
+
+void Screen::WaitEvents(std::uint64_t timeout) {
+  glfwWaitEventsTimeout(timeout / 1e9);
+}
+
+// Expands the rows set in the bitmap to RGBA
+void Screen::UpdateTextureData(std::uint32_t rows) {
+  for (unsigned int y = 0; y < DISPLAY_HEIGHT; y++) {
+    if (!(rows >> y & 1)) continue;
+    std::uint64_t row = shownRows[y];
+    for (unsigned int x = 0; x < DISPLAY_WIDTH; x++) {
+      unsigned char value = (row >> (DISPLAY_WIDTH - 1 - x)) & 1 ? 255 : 0;
+      unsigned int i = y * DISPLAY_WIDTH + x;
+      (*textureData)[i * 4]     = value;
+      (*textureData)[i * 4 + 1] = value;
+      (*textureData)[i * 4 + 2] = value;
+      (*textureData)[i * 4 + 3] = 255;
+    }
+  }
+}
+
+// Re-expands the rows set in the bitmap and sends each contiguous run once
+void Screen::UploadRows(std::uint32_t rows) {
+  UpdateTextureData(rows);
+  for (int y = 0; y < DISPLAY_HEIGHT;) {
+    if (!(rows >> y & 1)) {
+      y++;
+      continue;
+    }
+    int first = y;
+    while (y < DISPLAY_HEIGHT && (rows >> y & 1)) y++;
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, first, DISPLAY_WIDTH, y - first, GL_RGBA, GL_UNSIGNED_BYTE,
+                    textureData->data() + first * DISPLAY_WIDTH * 4);
   }
 }
 
@@ -161,11 +218,9 @@ void Screen::MenuBar() {
       if (ImGui::BeginMenu("Open")) {
         fs::path path = "../roms/";
         for (const auto &entry : fs::directory_iterator(path)) {
-          std::stringstream filePath;
           std::string fileName = entry.path().filename();
-          filePath << path.c_str() << fileName;
           if (ImGui::MenuItem(fileName.c_str())) {
-            chip8->LoadROM(filePath.str().c_str()); 
+            chip8->Send({ COMMAND_LOAD_ROM, 0, 0, entry.path().string() });
           }
         }
         ImGui::EndMenu();
@@ -179,10 +234,10 @@ void Screen::MenuBar() {
 void Screen::Debugger() {
   // Debugger Settings
   static int steps = 1;
-  static int stepCounter = 0;
   static int toggleHex = 1;
   static ImGuiTableFlags tableFlags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg;
-  int freq = static_cast<int>(chip8->instructionFrequency);
+  const Snapshot &state = chip8->GetSnapshot();
+  int ips = static_cast<int>(state.instructionsPerSecond);
 
   /* Chip8 Screen Window */
   static ImVec2 imageSize(int(WIDTH / 2), int(HEIGHT / 2));
@@ -195,48 +250,31 @@ void Screen::Debugger() {
 
   /* Chip8 State Window */
   static ImVec2 stateSize(int(screenSize.x / 2), screenSize.y);
-  std::stringstream opcodeStream, pcStream, I_Stream, keyStream, delayStream, soundStream, spStream;
   ImGui::SetNextWindowPos(ImVec2(0.0f, 19.0f));
   ImGui::SetNextWindowSize(stateSize);
   ImGui::Begin("State");
   ImGui::RadioButton("Hex", &toggleHex, 1); ImGui::SameLine();
   ImGui::RadioButton("Decimal", &toggleHex, 0);
-  // Initialize Chip8 States as String Streams
-  opcodeStream << "Opcode:        " << Utilities::FormatHex(4, chip8->opcode);
-  pcStream     << "PC:            ";
-  I_Stream     << "I:             ";
-  keyStream    << "Key:           ";
-  delayStream  << "Delay Timer:   ";
-  soundStream  << "Sound Timer:   ";
-  spStream     << "Stack Pointer: ";
-  // Formats state information depending on user selection
-  if (toggleHex) {
-    pcStream    << Utilities::FormatHex(3, chip8->pc);
-    I_Stream    << Utilities::FormatHex(3, chip8->I);
-    keyStream   << Utilities::FormatHex(1, int(chip8->keyPressed));
-    delayStream << Utilities::FormatHex(2, int(chip8->delayTimer));
-    soundStream << Utilities::FormatHex(2, int(chip8->soundTimer));
-    spStream    << Utilities::FormatHex(2, int(chip8->sp));
-  }
-  else {
-    pcStream    << chip8->pc;
-    I_Stream    << chip8->I;
-    keyStream   << int(chip8->keyPressed);
-    delayStream << int(chip8->delayTimer); 
-    soundStream << int(chip8->soundTimer); 
-    spStream    << int(chip8->sp);
-  }
+  // Formats state information depending on user selection (fixed buffers, nothing is allocated per frame)
+  auto field = [&](StateLine &line, unsigned value, int digits) -> StateLine & {
+    return toggleHex ? line.Hex(value, digits) : line.Decimal(value);
+  };
+  StateLine pcLine("PC:            "), I_Line("I:             "), keyLine("Key:           ");
+  StateLine delayLine("Delay Timer:   "), soundLine("Sound Timer:   "), spLine("Stack Pointer: ");
+  StateLine opcodeLine("Opcode:        ");
+  field(pcLine, state.pc, 3);
+  field(I_Line, state.I, 3);
   // Set Key Indicator to NONE if nothing is pressed
-  if (chip8->keyPressed == -1) {
-    keyStream.str("Key:           NONE");
+  if (state.pressedKey == -1) keyLine.Append("NONE");
+  else field(keyLine, state.pressedKey, 1);
+  field(delayLine, state.delayTimer, 2);
+  field(soundLine, state.soundTimer, 2);
+  field(spLine, state.sp, 2);
+  opcodeLine.Hex(state.opcode, 4);
+  // Displays Chip8 State
+  for (const StateLine *line : { &pcLine, &I_Line, &keyLine, &delayLine, &soundLine, &opcodeLine }) {
+    ImGui::TextUnformatted(line->Begin(), line->End());
   }
-  // Displays Chip8 State as Formatted Strings
-  ImGui::TextUnformatted(pcStream.str().c_str());
-  ImGui::TextUnformatted(I_Stream.str().c_str());
-  ImGui::TextUnformatted(keyStream.str().c_str());
-  ImGui::TextUnformatted(delayStream.str().c_str());
-  ImGui::TextUnformatted(soundStream.str().c_str());
-  ImGui::TextUnformatted(opcodeStream.str().c_str());
   // Displays V-Registers as a Table
   ImGui::SeparatorText("V-Registers");
   if (ImGui::BeginTable("Registers", 2, tableFlags)) {
@@ -246,18 +284,18 @@ void Screen::Debugger() {
     for (int row = 0; row < 16; row ++) {
       ImGui::TableNextRow();
       ImGui::TableNextColumn();
-      ImGui::Text("V[%.1X]", row);
+      StateLine name("V["), value;
+      name.Append(hexNibbles[row]).Append("]");
+      ImGui::TextUnformatted(name.Begin(), name.End());
       ImGui::TableNextColumn();
-      if (toggleHex)
-        ImGui::Text("0x%.2X", chip8->V[row]);
-      else
-        ImGui::Text("%d", chip8->V[row]);
+      field(value, state.V[row], 2);
+      ImGui::TextUnformatted(value.Begin(), value.End());
     }
     ImGui::EndTable();
   }
   // Stack
   ImU32 activeColor = ImGui::GetColorU32(ImVec4(0.0f, 0.73f, 1.0f, 0.5f));
-  ImGui::TextUnformatted(spStream.str().c_str());
+  ImGui::TextUnformatted(spLine.Begin(), spLine.End());
   ImGui::SeparatorText("Stack");
   if (ImGui::BeginTable("Stack", 2, tableFlags)) {
     ImGui::TableSetupColumn("Index");
@@ -266,11 +304,14 @@ void Screen::Debugger() {
     for (int i = 0; i < 16; i++) {
       ImGui::TableNextRow();
       ImGui::TableNextColumn();
-      if (i == chip8->sp - 1) ImGui::TableSetBgColor(ImGuiTableBgTarget_CellBg, activeColor);
-      ImGui::Text("0x%.1X", i);
+      if (i == state.sp - 1) ImGui::TableSetBgColor(ImGuiTableBgTarget_CellBg, activeColor);
+      StateLine index, function;
+      index.Hex(i, 1);
+      function.Hex(state.stack[i], 3);
+      ImGui::TextUnformatted(index.Begin(), index.End());
       ImGui::TableNextColumn();
-      if (i == chip8->sp - 1) ImGui::TableSetBgColor(ImGuiTableBgTarget_CellBg, activeColor);
-      ImGui::Text("0x%.3X", chip8->stack[i]);
+      if (i == state.sp - 1) ImGui::TableSetBgColor(ImGuiTableBgTarget_CellBg, activeColor);
+      ImGui::TextUnformatted(function.Begin(), function.End());
     }
     ImGui::EndTable();
   }
@@ -285,73 +326,142 @@ void Screen::Debugger() {
   ImGui::SetNextWindowSize(controlsSize);
   ImGui::Begin("Controls");
   ImGui::PushItemWidth(100.0f);
-  // Instruction Frequency Controls
-  ImGui::InputInt("Instruction Frequency", &freq);
-  chip8->instructionFrequency = freq;
+  // Instructions per Second Controls
+  if (ImGui::InputInt("Instructions/s", &ips, FRAME_RATE, 100 * FRAME_RATE))
+    chip8->Send({ COMMAND_SET_IPS, static_cast<unsigned long>(std::max(ips, 1)) });
   // Controls for Steps per Button Click
   ImGui::InputInt("Step Count", &steps);
   ImGui::PopItemWidth();
   // Pause Button
   if (ImGui::Button("Pause")) {
-    chip8->paused = !chip8->paused;
+    chip8->Send({ COMMAND_TOGGLE_PAUSE });
   }
-  // Step Button
-  if (ImGui::Button("Step")) {
-    if (chip8->paused) {
-      for (int i = 0; i < steps; i++) {
-        // Ensures that timers are decremented at 60 HZ when paused 
-        if (stepCounter % 60 == 0) {
-          chip8->soundTimer = chip8->soundTimer > 0 ? chip8->soundTimer - 1 : 0;
-          chip8->delayTimer = chip8->delayTimer > 0 ? chip8->delayTimer - 1 : 0;
-        }
-        chip8->EmulateCycle();
-        stepCounter++;
-      }
-    }
+  // Step Button (timers are decremented at 60 Hz of stepped instructions)
+  if (ImGui::Button("Step") && state.paused) {
+    chip8->Send({ COMMAND_STEP, static_cast<unsigned long>(std::max(steps, 0)) });
   }
+  // Turbo (fast-forward as fast as the host allows; drawing stays vsynced on this thread)
+  bool turbo = state.turbo;
+  if (ImGui::Checkbox("Turbo", &turbo))
+    chip8->Send({ COMMAND_SET_TURBO, turbo });
+  ImGui::SameLine();
+  ImGui::Text("Speed: %.1fx", state.speed);
+  if (state.turbo) {
+    int drawInterval = static_cast<int>(state.turboDrawInterval);
+    ImGui::SetNextItemWidth(100.0f);
+    if (ImGui::InputInt("Draw Every N Frames", &drawInterval))
+      chip8->Send({ COMMAND_SET_DRAW_INTERVAL, static_cast<unsigned long>(std::max(drawInterval, 1)) });
+  }
+  // Rewind Button (held to rewind while running, each click steps back one refresh while paused)
+  static bool rewindHeld = false;
+  ImGui::Button("Rewind");
+  if (ImGui::IsItemActive() != rewindHeld) {
+    rewindHeld = ImGui::IsItemActive();
+    chip8->Send({ COMMAND_SET_REWINDING, rewindHeld });
+  }
+  if (state.paused && ImGui::IsItemClicked()) {
+    chip8->Send({ COMMAND_REWIND_FRAME });
+  }
+  ImGui::SameLine();
+  ImGui::Text("%.1fs (%zu KB)", state.rewindFrames / float(FRAME_RATE), state.rewindBytes / 1024);
   // Memory Window Input
   ImGui::Text("Jump to Address:"); ImGui::SameLine();
   ImGui::SetItemTooltip("Jumps to an address in the Memory window");
   ImGui::SetNextItemWidth(100.0f);
   if (ImGui::InputTextWithHint("##Address", "<XXX>", address, 4, ImGuiInputTextFlags_EnterReturnsTrue)) {
-    jumpAddress = std::stoi(address, 0, 16);
-    jumped = true;
+    char *end;
+    long parsed = std::strtol(address, &end, 16);
+    if (end != address && *end == '\0' && parsed >= 0 && parsed < MEMORY) {
+      jumpAddress = static_cast<int>(parsed);
+      jumped = true;
+    }
   }
   ImGui::SetItemTooltip("Enter a 3-digit hexadecimal address");
+  // Writes a byte at the jumped-to address
+  static char value[3] = "";
+  ImGui::Text("Poke 0x%.3X:", jumpAddress); ImGui::SameLine();
+  ImGui::SetNextItemWidth(100.0f);
+  if (ImGui::InputTextWithHint("##Value", "<XX>", value, 3, ImGuiInputTextFlags_EnterReturnsTrue)) {
+    char *end;
+    long parsed = std::strtol(value, &end, 16);
+    if (end != value && *end == '\0' && parsed >= 0 && parsed <= 0xFF)
+      chip8->Send({ COMMAND_POKE, static_cast<unsigned long>(parsed), static_cast<Word>(jumpAddress) });
+  }
+  ImGui::SetItemTooltip("Enter a 2-digit hexadecimal byte");
+  ImGui::Text("UI Allocations: %llu/frame", uiAllocations);
+#ifdef CHIP8_COUNT_ALLOCATIONS
+  ImGui::SetItemTooltip("Heap allocations made while building the previous frame's windows");
+#else
+  ImGui::SetItemTooltip("ImGui heap allocations made while building the previous frame's windows\n"
+                        "(build with CHIP8_COUNT_ALLOCATIONS to count every allocation)");
+#endif
   ImGui::End();
 
   /* Memory Window */
   ImVec2 memorySize = ImVec2(screenSize.x, screenSize.y - 70);
   ImU32 jumpColor = ImGui::GetColorU32(ImVec4(0.0f, 0.73f, 1.0f, 0.1f));
+  ImU32 indexColor = ImGui::GetColorU32(ImVec4(0.2f, 0.8f, 0.2f, 0.5f));
   ImGui::SetNextWindowSize(memorySize);
   ImGui::SetNextWindowPos(ImVec2(0, HEIGHT - memorySize.y));
   ImGui::Begin("Memory");
-  // Address Table
-  if (ImGui::BeginTable("Memory", 2, tableFlags)) {
-    // Moves scrollbar to jumped address (17 was experimentally determined using ImGui::GetScrollY())
-    if (jumped) {
-      ImGui::SetScrollY(17 * jumpAddress);
-      jumped = false;
-    }
+  // Bytes written since recent draws fade out over MEMORY_FADE_FRAMES (the first draw has nothing to compare with)
+  if (draws++ == 0) std::memcpy(previousMemory, state.memory, MEMORY);
+  for (int i = 0; i < MEMORY; i++) {
+    if (state.memory[i] != previousMemory[i]) changedAt[i] = draws;
+  }
+  std::memcpy(previousMemory, state.memory, MEMORY);
+#ifdef CHIP8_PROFILE
+  // Fetch counts are log-scaled so loops that run a few times still show up next to the main loop
+  double heatScale = 1.0 / std::log2(2.0 + state.profile.MaxVisits());
+#endif
+  // Hex Dump (16 bytes per row; only the rows in view are submitted)
+  ImGuiTableFlags memoryFlags = tableFlags | ImGuiTableFlags_ScrollY | ImGuiTableFlags_SizingFixedFit;
+  if (ImGui::BeginTable("Memory", MEMORY_ROW_BYTES + 1, memoryFlags)) {
+    int jumpRow = jumpAddress / MEMORY_ROW_BYTES;
+    ImGui::TableSetupScrollFreeze(1, 1);
     ImGui::TableSetupColumn("Address");
-    ImGui::TableSetupColumn("Value");
+    for (int column = 0; column < MEMORY_ROW_BYTES; column++) {
+      ImGui::TableSetupColumn(hexNibbles[column]);
+    }
     ImGui::TableHeadersRow();
-    for (int i = 0; i < MEMORY; i++) {
-      bool cellJumped = i == jumpAddress;
-      bool cellActive = i == chip8->pc || i == chip8->pc + 1;
-      ImGui::TableNextRow();
-      // -- Address
-      ImGui::TableNextColumn();
-      // Highlight address if it was input
-      if (cellJumped) ImGui::TableSetBgColor(ImGuiTableBgTarget_CellBg, jumpColor);
-      // Highlight current PC memory location + next address
-      if (cellActive) ImGui::TableSetBgColor(ImGuiTableBgTarget_CellBg, activeColor);
-      ImGui::Text("0x%.3X", i);
-      // -- Value
-      ImGui::TableNextColumn();
-      if (cellJumped) ImGui::TableSetBgColor(ImGuiTableBgTarget_CellBg, jumpColor);
-      if (cellActive) ImGui::TableSetBgColor(ImGuiTableBgTarget_CellBg, activeColor);
-      ImGui::Text("0x%.2X", chip8->memory[i]);
+
+    ImGuiListClipper clipper;
+    clipper.Begin(MEMORY / MEMORY_ROW_BYTES);
+    if (jumped) clipper.IncludeItemByIndex(jumpRow);
+    while (clipper.Step()) {
+      for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+        ImGui::TableNextRow();
+        // Scrolls the jumped-to row to the top of the view
+        if (jumped && row == jumpRow) {
+          ImGui::SetScrollHereY(0.0f);
+          jumped = false;
+        }
+        ImGui::TableNextColumn();
+        StateLine address;
+        address.Hex(row * MEMORY_ROW_BYTES, 3);
+        ImGui::TextUnformatted(address.Begin(), address.End());
+        for (int column = 0; column < MEMORY_ROW_BYTES; column++) {
+          int i = row * MEMORY_ROW_BYTES + column;
+          unsigned long age = draws - changedAt[i];
+          ImU32 color = 0;
+          ImGui::TableNextColumn();
+          // Highlight priority: PC, I, jumped address, recent write, fetch heat
+          if (i == state.pc || i == state.pc + 1) color = activeColor;
+          else if (i == state.I) color = indexColor;
+          else if (i == jumpAddress) color = jumpColor;
+          else if (changedAt[i] && age < MEMORY_FADE_FRAMES)
+            color = ImGui::GetColorU32(ImVec4(1.0f, 0.85f, 0.0f, 0.6f * (MEMORY_FADE_FRAMES - age) / MEMORY_FADE_FRAMES));
+#ifdef CHIP8_PROFILE
+          else if (unsigned long long visits = state.profile.Visits(i)) {
+            float heat = float(std::log2(1.0 + visits) * heatScale);
+            color = ImGui::GetColorU32(ImVec4(1.0f, 0.35f, 0.0f, 0.1f + 0.6f * heat));
+          }
+#endif
+          if (color) ImGui::TableSetBgColor(ImGuiTableBgTarget_CellBg, color);
+          const auto &digits = Utilities::hexBytes[state.memory[i]];
+          ImGui::TextUnformatted(digits.data(), digits.data() + 2);
+        }
+      }
     }
     ImGui::EndTable();
   }
@@ -362,21 +472,98 @@ void Screen::Debugger() {
   ImGui::SetNextWindowSize(logSize);
   ImGui::SetNextWindowPos(ImVec2(int(WIDTH / 2), HEIGHT - logSize.y));
   ImGui::Begin("Log");
-  for (int i = 0; i < debugLog.size(); i++) {
-    ImGui::TextUnformatted(debugLog[i].c_str());
+#ifdef CHIP8_TRACE
+  // Only the rows that are scrolled into view get formatted
+  static char entry[512];
+  ImGuiListClipper clipper;
+  clipper.Begin(state.trace.Size());
+  while (clipper.Step()) {
+    for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+      FormatTrace(state.trace[i], entry, sizeof(entry));
+      ImGui::TextUnformatted(entry);
+    }
   }
+#else
+  ImGui::TextUnformatted("Tracing disabled (build with CHIP8_TRACE=ON)");
+#endif
   ImGui::End();
-}
 
-void Screen::PushToLog(std::string entry) {
-  /*std::cout << entry << "\n";*/
-  int size = debugLog.size();
-  if (size < 100) {
-    debugLog.push_back(entry);
-  } else {
-    std::rotate(debugLog.data(), debugLog.data() + 1, debugLog.data() + size);
-    debugLog[size - 1] = entry;
+  /* Profile */
+  ImGui::SetNextWindowSize(ImVec2(screenSize.x / 2, memorySize.y), ImGuiCond_FirstUseEver);
+  ImGui::SetNextWindowPos(ImVec2(screenSize.x / 4, HEIGHT - memorySize.y), ImGuiCond_FirstUseEver);
+  ImGui::Begin("Profile");
+#ifdef CHIP8_PROFILE
+  static int selected = -1;
+  const Profile &profile = state.profile;
+  double total = std::max<unsigned long long>(profile.Total(), 1);
+  unsigned long long classTotals[16] = {};
+  for (int op = 0; op < OP_COUNT; op++) {
+    if (OperationClass(op) >= 0) classTotals[OperationClass(op)] += profile.Count(op);
   }
+  ImGui::Text("Instructions: %llu", profile.Total());
+  if (profile.FastForwarded()) {
+    ImGui::SameLine();
+    ImGui::TextDisabled("(%.1f%% fast-forwarded idle loops, counted but not timed)", 100.0 * profile.FastForwarded() / total);
+  }
+  if (ImGui::BeginTable("Classes", 8, tableFlags)) {
+    for (int c = 0; c < 16; c++) {
+      ImGui::TableNextColumn();
+      ImGui::Text("%Xxxx %4.1f%%", c, 100.0 * classTotals[c] / total);
+    }
+    ImGui::EndTable();
+  }
+  // Cost distribution of the operation picked in the table below
+  if (selected >= 0) {
+    float buckets[PROFILE_BUCKETS];
+    for (int b = 0; b < PROFILE_BUCKETS; b++) buckets[b] = float(profile.Histogram(selected)[b]);
+    ImGui::PlotHistogram("##Cost", buckets, PROFILE_BUCKETS, 0, OperationName(selected), 0.0f, FLT_MAX, ImVec2(-1, 60));
+  }
+  // Hottest fetch addresses; selecting one scrolls the Memory window to it
+  if (ImGui::CollapsingHeader("Hot Addresses", ImGuiTreeNodeFlags_DefaultOpen)) {
+    int hot[PROFILE_HOT_ADDRESSES];
+    int hotCount = profile.HotAddresses(hot, PROFILE_HOT_ADDRESSES);
+    for (int i = 0; i < hotCount; i++) {
+      char label[48];
+      std::snprintf(label, sizeof(label), "0x%.3X  %04X  %5.2f%%", hot[i],
+                    (state.memory[hot[i]] << 8) | state.memory[(hot[i] + 1) & (MEMORY - 1)],
+                    100.0 * profile.Visits(hot[i]) / total);
+      if (ImGui::Selectable(label, jumpAddress == hot[i])) {
+        jumpAddress = hot[i];
+        jumped = true;
+      }
+    }
+  }
+  if (ImGui::BeginTable("Operations", 4, tableFlags | ImGuiTableFlags_ScrollY)) {
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableSetupColumn("Operation");
+    ImGui::TableSetupColumn("Count");
+    ImGui::TableSetupColumn("%");
+    ImGui::TableSetupColumn("Avg Ticks");
+    ImGui::TableHeadersRow();
+    for (int op = 0; op < OP_COUNT; op++) {
+      unsigned long long count = profile.Count(op);
+      if (count == 0) continue;
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      if (ImGui::Selectable(OperationName(op), selected == op, ImGuiSelectableFlags_SpanAllColumns))
+        selected = op;
+      ImGui::TableNextColumn();
+      ImGui::Text("%llu", count);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.2f", 100.0 * count / total);
+      ImGui::TableNextColumn();
+#ifdef CHIP8_PROFILE_TIMING
+      ImGui::Text("%.1f", profile.Samples(op) ? double(profile.Ticks(op)) / profile.Samples(op) : 0.0);
+#else
+      ImGui::TextUnformatted("-");
+#endif
+    }
+    ImGui::EndTable();
+  }
+#else
+  ImGui::TextUnformatted("Profiling disabled (build with CHIP8_PROFILE=ON)");
+#endif
+  ImGui::End();
 }
 
 void framebufferSizeCallback(GLFWwindow *window, int width, int height) {
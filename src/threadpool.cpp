@@ -0,0 +1,88 @@
+#include "threadpool.h"
+
+ThreadPool::ThreadPool(unsigned threads) {
+  if (threads == 0) threads = 1;
+  nextQueue = 0;
+  queued = 0;
+  pending = 0;
+  stopping = false;
+  for (unsigned i = 0; i < threads; i++) {
+    queues.push_back(std::make_unique<Queue>());
+  }
+  for (unsigned i = 0; i < threads; i++) {
+    workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+  }
+}
+
+void ThreadPool::Submit(std::function<void(unsigned)> task) {
+  Queue &queue = *queues[nextQueue++ % queues.size()];
+  {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(std::move(task));
+  }
+  {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    queued++;
+    pending++;
+  }
+  taskAvailable.notify_one();
+}
+
+bool ThreadPool::PopTask(unsigned index, std::function<void(unsigned)> &task) {
+  // Own queue first (LIFO keeps recently submitted work warm)
+  {
+    Queue &own = *queues[index];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      queued--;
+      return true;
+    }
+  }
+  // Steal the oldest task from another worker
+  for (unsigned i = 1; i < queues.size(); i++) {
+    Queue &victim = *queues[(index + i) % queues.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      queued--;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::WorkerLoop(unsigned index) {
+  std::function<void(unsigned)> task;
+  while (true) {
+    if (PopTask(index, task)) {
+      task(index);
+      std::lock_guard<std::mutex> lock(stateMutex);
+      if (--pending == 0) tasksDone.notify_all();
+      continue;
+    }
+    // Submit increments queued under the lock, so checking it here cannot miss a wakeup
+    std::unique_lock<std::mutex> lock(stateMutex);
+    taskAvailable.wait(lock, [&] { return stopping || queued > 0; });
+    if (stopping && queued == 0) return;
+  }
+}
+
+void ThreadPool::Wait() {
+  std::unique_lock<std::mutex> lock(stateMutex);
+  tasksDone.wait(lock, [&] { return pending == 0; });
+}
+
+ThreadPool::~ThreadPool() {
+  Wait();
+  {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    stopping = true;
+  }
+  taskAvailable.notify_all();
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+}
@@ -0,0 +1,154 @@
+#include "trace.h"
+#include <algorithm>
+#include <cstdio>
+
+int FormatTrace(const TraceEntry &entry, char *buffer, std::size_t size) {
+  unsigned short opcode = entry.opcode;
+  unsigned x = (opcode & 0x0F00) >> 8;
+  unsigned y = (opcode & 0x00F0) >> 4;
+  unsigned n = opcode & 0x000F;
+  unsigned nn = opcode & 0x00FF;
+  unsigned nnn = opcode & 0x0FFF;
+  bool skipped = entry.flags & TRACE_SKIPPED;
+  bool stalled = entry.flags & TRACE_STALLED;
+  const unsigned char *V = entry.V;
+  int length = 0;
+
+  // Appends formatted text to the buffer, never writing past its end; length counts only what
+  // was stored, so a truncated line still reports a length that fits the buffer
+  auto append = [&](const char *format, auto... args) {
+    if (length >= int(size) - 1) return;
+    int written = std::snprintf(buffer + length, size - length, format, args...);
+    if (written > 0) length += std::min(written, int(size) - 1 - length);
+  };
+
+  switch (opcode & 0xF000) {
+    case 0x0000:
+      if (opcode == 0x00E0)
+        append("0x00E0 CLS           |\tClearing Screen");
+      else if (opcode == 0x00EE && stalled)
+        append("0x00EE RET           |\tStack Underflow! SP = %d", entry.sp);
+      else if (opcode == 0x00EE)
+        append("0x00EE RET           |\tReturning to 0x%.3X", entry.nextPC);
+      break;
+    case 0x1000:
+      append("0x%.4X JP nnn        |\tSetting PC to: 0x%.3X", opcode, entry.nextPC);
+      break;
+    case 0x2000:
+      if (entry.nextPC != nnn)
+        append("0x%.4X CALL nnn      |\tStack Overflow! SP = %d", opcode, entry.sp);
+      else
+        append("0x%.4X CALL nnn      |\tCalling function at: 0x%.3X", opcode, entry.nextPC);
+      break;
+    case 0x3000:
+      append("0x%.4X SE Vx, bb     |\t%s", opcode, skipped ? "Equal, Skipping" : "Not Equal, Not Skipping");
+      break;
+    case 0x4000:
+      append("0x%.4X SNE Vx, bb    |\t%s", opcode, skipped ? "Not Equal, Skipping" : "Equal, Not Skipping");
+      break;
+    case 0x5000:
+      append("0x%.4X SE Vx, Vy     |\t%s", opcode, skipped ? "Equal, Skipping" : "Not Equal, Not Skipping");
+      break;
+    case 0x6000:
+      append("0x%.4X LD Vx, bb     |\tLoaded %d into V[0x%.1X]", opcode, V[x], x);
+      break;
+    case 0x7000:
+      append("0x%.4X ADD Vx, bb    |\tIncrementing V[0x%.1X] by %d", opcode, x, nn);
+      break;
+    case 0x8000:
+      switch (n) {
+        case 0x0:
+          append("0x%.4X LD Vx, Vy     |\tLoading %d into V[0x%.1X]", opcode, V[x], x);
+          break;
+        case 0x1:
+          append("0x%.4X OR Vx, Vy     |\tORing V[0x%.1X] and V[0x%.1X] = %d", opcode, x, y, V[x]);
+          break;
+        case 0x2:
+          append("0x%.4X AND Vx, Vy    |\tANDing V[0x%.1X] and V[0x%.1X] = %d", opcode, x, y, V[x]);
+          break;
+        case 0x3:
+          append("0x%.4X XOR Vx, Vy    |\tXORing V[0x%.1X] and V[0x%.1X] = %d", opcode, x, y, V[x]);
+          break;
+        case 0x4:
+          append("0x%.4X ADD Vx, Vy    |\tV[0x%.1X] + V[0x%.1X] = %d; V[0xF] = %d", opcode, x, y, V[x], V[0xF]);
+          break;
+        case 0x5:
+          append("0x%.4X SUB Vx, Vy    |\tV[0x%.1X] - V[0x%.1X] = %d; V[0xF] = %d", opcode, x, y, V[x], V[0xF]);
+          break;
+        case 0x6:
+          append("0x%.4X SHR Vx        |\tV[0x%.1X] >> 1 = %d; V[0xF] = %d", opcode, x, V[x], V[0xF]);
+          break;
+        case 0x7:
+          append("0x%.4X SUBN Vx, Vy   |\tV[0x%.1X] - V[0x%.1X] = %d; V[0xF] = %d", opcode, y, x, V[x], V[0xF]);
+          break;
+        case 0xE:
+          append("0x%.4X SHL Vx        |\tV[0x%.1X] << 1 = %d; V[0xF] = %d", opcode, x, V[x], V[0xF]);
+          break;
+      }
+      break;
+    case 0x9000:
+      append("0x%.4X SNE Vx, Vy    |\t%s", opcode, skipped ? "Not Equal, Skipping" : "Equal, Not Skipping");
+      break;
+    case 0xA000:
+      append("0x%.4X LD I, nnn     |\tLoaded 0x%.3X into I", opcode, entry.I);
+      break;
+    case 0xB000:
+      append("0x%.4X JP V0, addr   |\tSet PC to: 0x%.3X", opcode, entry.nextPC);
+      break;
+    case 0xC000:
+      append("0x%.4X RND Vx, bb    |\tSetting V[0x%.1X] to %d", opcode, x, V[x]);
+      break;
+    case 0xD000:
+      append("0x%.4X DRW Vx, Vy, n |\tDrawing at (%d, %d), height = %d; V[0xF] = %d", opcode, V[x], V[y], n, V[0xF]);
+      break;
+    case 0xE000:
+      if (nn == 0x9E)
+        append("0x%.4X SKP Vx        |\t0x%.1X pressed? %s", opcode, V[x], skipped ? "Yes, skipping" : "No, not skipping");
+      else if (nn == 0xA1)
+        append("0x%.4X SKNP Vx       |\t0x%.1X pressed? %s", opcode, V[x], skipped ? "No, skipping" : "Yes, not skipping");
+      break;
+    case 0xF000:
+      switch (nn) {
+        case 0x07:
+          append("0x%.4X LD Vx, DT     |\tSetting V[0x%.1X] = %d", opcode, x, V[x]);
+          break;
+        case 0x0A:
+          append("0x%.4X LD Vx, K      |\tWating for input... ", opcode);
+          if (!stalled) append("Key 0x%.1X pressed", V[x]);
+          break;
+        case 0x15:
+          append("0x%.4X LD DT, Vx     |\tSetting Delay Timer = %d", opcode, V[x]);
+          break;
+        case 0x18:
+          append("0x%.4X LD ST, Vx     |\tSetting Sound Timer = %d", opcode, V[x]);
+          break;
+        case 0x1E:
+          append("0x%.4X ADD I, Vx     |\tI + V[0x%.1X] = 0x%.3X", opcode, x, entry.I);
+          break;
+        case 0x29:
+          append("0x%.4X LD F, Vx      |\t", opcode);
+          break;
+        case 0x33:
+          append("0x%.4X LD B, Vx      |\t", opcode);
+          append("memory[0x%.3X] = %d; ", entry.I, V[x] / 100);
+          append("memory[0x%.3X] = %d; ", entry.I + 1, (V[x] % 100) / 10);
+          append("memory[0x%.3X] = %d; ", entry.I + 2, V[x] % 10);
+          break;
+        case 0x55:
+          append("0x%.4X LD [I], Vx    |\t", opcode);
+          for (unsigned i = 0; i <= x && entry.I + i < 4096; i++)
+            append("memory[0x%.3X] = %d; ", entry.I + i, V[i]);
+          break;
+        case 0x65:
+          append("0x%.4X LD Vx, [I]    |\t", opcode);
+          for (unsigned i = 0; i <= x && entry.I + i < 4096; i++)
+            append("V[0x%.1X] = %d; ", i, V[i]);
+          break;
+      }
+      break;
+  }
+  if (entry.flags & TRACE_IDLE)
+    append(" (idle, %lu instructions fast-forwarded)", entry.idleCycles);
+  if (length == 0 && size > 0) buffer[0] = '\0';
+  return length;
+}